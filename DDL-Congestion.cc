@@ -1,3 +1,4 @@
+#include <cmath>
 #include <fstream>
 #include <string>
 #include "ns3/core-module.h"
@@ -5,22 +6,41 @@
 #include "ns3/internet-module.h"
 #include "ns3/point-to-point-module.h"
 #include "ns3/applications-module.h"
-#include "ns3/ipv4-global-routing-helper.h"
-#include "ns3/flow-monitor-module.h"
 #include "ns3/traffic-control-module.h"
+#include <chrono>
 #include <iostream>
+#include "DDL-Topology.h"
+#include "DDL-Routing.h"
+#include "DDL-Distributed.h"
+#include "DDL-Pcn.h"
+#include "DDL-QueueTrace.h"
+#include "DDL-TraceWriter.h"
+#include "DDL-FlowCounter.h"
+#include "DDL-Training.h"
+#include "DDL-PacedSender.h"
+#include "DDL-Profiler.h"
+#include "DDL-FlowProbe.h"
+#include "DDL-Stats.h"
+#include "DDL-Scenario.h"
 
 using namespace ns3;
 
-std::ofstream q1Size;
-std::ofstream q2Size;
-std::ofstream throughput;
-std::map<FlowId, uint32_t> TotalRxBytes;
+TraceWriter throughput;
+TraceWriter pcnLog;
+TraceWriter burstLog;
+FlowRxCounter flowCounter;
+HostFlowProbe flowProbe;
+RunStats runStats;
+TraceWriter iterationLog;
+SimProfiler profiler;
 std::vector<ApplicationContainer> onOffApps;
 std::vector<ApplicationContainer> sinkApps;
+std::vector<Ptr<DdlWorkerApp>> trainingWorkers;
+// Application type behind createApps and createBackgroundApps (--sender)
+std::string senderType = "ns3::OnOffApplication";
 
-void createBackgroundApps(InetSocketAddress sinkAddress, Ptr<Node> source, Ptr<Node> dest, uint32_t dataRate, uint32_t packetSize, double startTime, double stopTime, int onTime, int offTime){
-    OnOffHelper onOffHelper("ns3::TcpSocketFactory", sinkAddress);
+void createBackgroundApps(InetSocketAddress sinkAddress, Ptr<Node> source, Ptr<Node> dest, uint32_t dataRate, uint32_t packetSize, double startTime, double stopTime, double onTime, double offTime){
+    SenderHelper onOffHelper(senderType, "ns3::TcpSocketFactory", sinkAddress);
     Ptr<ExponentialRandomVariable> onTime_ = CreateObject<ExponentialRandomVariable>();
     onTime_->SetAttribute("Mean", DoubleValue(onTime));
 
@@ -36,190 +56,573 @@ void createBackgroundApps(InetSocketAddress sinkAddress, Ptr<Node> source, Ptr<N
     onOffHelper.SetAttribute("DataRate", StringValue(std::to_string(dataRate) + "Mbps"));
     onOffHelper.SetAttribute("PacketSize", UintegerValue(packetSize));
 
-    ApplicationContainer app = onOffHelper.Install(source);
+    // In distributed runs only the rank owning a node installs its apps
+    ApplicationContainer app;
+    if(IsLocal(source)){
+        app = onOffHelper.Install(source);
+    }
     app.Start(Seconds(startTime));
     app.Stop(Seconds(stopTime));
 
     PacketSinkHelper sinkHelper("ns3::TcpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), sinkAddress.GetPort()));
-    ApplicationContainer sinkApp = sinkHelper.Install(dest);
+    ApplicationContainer sinkApp;
+    if(IsLocal(dest)){
+        sinkApp = sinkHelper.Install(dest);
+    }
     sinkApp.Start(Seconds(startTime));
     sinkApp.Stop(Seconds(stopTime));
+    if(sinkApp.GetN() > 0){
+        Ipv4Address sourceAddress = source->GetObject<Ipv4>()->GetAddress(1, 0).GetLocal();
+        flowCounter.Track(sinkApp.Get(0), sourceAddress, sinkAddress.GetIpv4(), sinkAddress.GetPort());
+    }
 
     onOffApps.push_back(app);
     sinkApps.push_back(sinkApp);
 }
 
-void createApps(InetSocketAddress sinkAddress, Ptr<Node> source, Ptr<Node> dest, uint32_t dataRate, uint32_t packetSize, double startTime, double stopTime, int onTime, int offTime){
-    OnOffHelper onOffHelper("ns3::TcpSocketFactory", sinkAddress);
+void createApps(InetSocketAddress sinkAddress, Ptr<Node> source, Ptr<Node> dest, uint32_t dataRate, uint32_t packetSize, double startTime, double stopTime, double onTime, double offTime){
+    SenderHelper onOffHelper(senderType, "ns3::TcpSocketFactory", sinkAddress);
     onOffHelper.SetAttribute("OnTime", StringValue("ns3::ConstantRandomVariable[Constant=" + std::to_string(onTime) + "]"));
     onOffHelper.SetAttribute("OffTime", StringValue("ns3::ConstantRandomVariable[Constant=" + std::to_string(offTime) + "]"));
     onOffHelper.SetAttribute("DataRate", StringValue(std::to_string(dataRate) + "Mbps"));
     onOffHelper.SetAttribute("PacketSize", UintegerValue(packetSize));
 
-    ApplicationContainer app = onOffHelper.Install(source);
+    // In distributed runs only the rank owning a node installs its apps
+    ApplicationContainer app;
+    if(IsLocal(source)){
+        app = onOffHelper.Install(source);
+    }
     app.Start(Seconds(startTime));
     app.Stop(Seconds(stopTime));
 
     PacketSinkHelper sinkHelper("ns3::TcpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), sinkAddress.GetPort()));
-    ApplicationContainer sinkApp = sinkHelper.Install(dest);
+    ApplicationContainer sinkApp;
+    if(IsLocal(dest)){
+        sinkApp = sinkHelper.Install(dest);
+    }
     sinkApp.Start(Seconds(startTime));
     sinkApp.Stop(Seconds(stopTime));
+    if(sinkApp.GetN() > 0){
+        Ipv4Address sourceAddress = source->GetObject<Ipv4>()->GetAddress(1, 0).GetLocal();
+        flowCounter.Track(sinkApp.Get(0), sourceAddress, sinkAddress.GetIpv4(), sinkAddress.GetPort());
+    }
 
     onOffApps.push_back(app);
     sinkApps.push_back(sinkApp);
 }
 
-void LogQueue1Size(Ptr<QueueDisc> queueDisc){
-    uint32_t qsize = queueDisc->GetNPackets();
-    q1Size << Simulator::Now().GetMilliSeconds() << "," << qsize << "\n";
-    Simulator::Schedule(MilliSeconds(100), &LogQueue1Size, queueDisc);
+void LogIteration(uint32_t worker, uint32_t iteration, Time start, Time firstSend, Time computeEnd, Time commEnd){
+    // Share of the communication that ran while the backward pass was still computing
+    double overlap = commEnd > firstSend ? std::max(0.0, (computeEnd - firstSend).GetSeconds()) / (commEnd - firstSend).GetSeconds() : 1.0;
+    iterationLog.Append(worker, iteration, start.GetMicroSeconds() / 1e3, computeEnd.GetMicroSeconds() / 1e3, commEnd.GetMicroSeconds() / 1e3, (commEnd - start).GetMicroSeconds() / 1e3, (commEnd - computeEnd).GetMicroSeconds() / 1e3, std::min(overlap, 1.0));
 }
 
-void LogQueue2Size(Ptr<QueueDisc> queueDisc){
-    uint32_t qsize = queueDisc->GetNPackets();
-    q2Size << Simulator::Now().GetMilliSeconds() << "," << qsize << "\n";
-    Simulator::Schedule(MilliSeconds(100), &LogQueue2Size, queueDisc);
+// Training traffic between the workers and PSs (mode "ps") or around a ring
+// of the workers (mode "ring"); see DDL-Training.h
+void createTrainingApps(const DdlTopology& topo, const std::string& mode, const ModelProfile& model, const CommSchedule& schedule, Time computeTime, uint32_t iterations, double startTime, double stopTime){
+    uint16_t port = 5000;
+    uint32_t nWorkers = topo.workers.GetN();
+    uint32_t nPs = topo.ps.GetN();
+    uint8_t tos = schedule.priority ? kTrainingTos : 0;
+    // One push coordinator per PS (--pushTokens)
+    std::vector<Ptr<DdlPushCoordinator>> coordinators;
+    if(mode == "ps" && schedule.tokens > 0){
+        for(uint32_t p = 0; p < nPs; p++){
+            coordinators.push_back(CreateObjectWithAttributes<DdlPushCoordinator>("MaxPushers", UintegerValue(schedule.tokens)));
+        }
+    }
+    if(mode == "ps"){
+        for(uint32_t p = 0; p < nPs; p++){
+            if(!IsLocal(topo.ps.Get(p))){
+                continue;
+            }
+            uint64_t shard = 0;
+            std::map<uint32_t, uint64_t> layers;
+            for(uint32_t l = p; l < model.layerBytes.size(); l += nPs){
+                shard += model.layerBytes[l];
+                layers[l] = model.layerBytes[l];
+            }
+            Ptr<DdlPsApp> ps = CreateObjectWithAttributes<DdlPsApp>("Port", UintegerValue(port),
+                                                                     "Tos", UintegerValue(tos));
+            ps->SetWorkers(topo.workerAddress);
+            ps->SetShardBytes(shard);
+            if(!coordinators.empty()){
+                ps->SetCoordinator(coordinators[p], layers);
+            }
+            std::vector<uint32_t> flows;
+            for(uint32_t w = 0; w < nWorkers; w++){
+                flows.push_back(flowCounter.Add(topo.workerAddress[w], topo.psAddress[p], port));
+            }
+            ps->TraceConnectWithoutContext("PeerRx", Callback<void, uint32_t, Ptr<const Packet>, const Address&>([flows](uint32_t w, Ptr<const Packet> packet, const Address& from){
+                flowCounter.Count(flows[w], packet->GetSize(), from);
+            }));
+            topo.ps.Get(p)->AddApplication(ps);
+            ps->SetStartTime(Seconds(startTime));
+            ps->SetStopTime(Seconds(stopTime));
+        }
+    }
+    for(uint32_t w = 0; w < nWorkers; w++){
+        if(!IsLocal(topo.workers.Get(w))){
+            trainingWorkers.push_back(nullptr);
+            continue;
+        }
+        Ptr<DdlWorkerApp> app = CreateObjectWithAttributes<DdlWorkerApp>("ComputeTime", TimeValue(computeTime),
+                                                                         "Iterations", UintegerValue(iterations),
+                                                                         "Port", UintegerValue(port),
+                                                                         "ChunkSize", UintegerValue(schedule.chunkSize),
+                                                                         "Tos", UintegerValue(tos));
+        app->SetModel(model);
+        if(mode == "ps"){
+            app->SetParameterServers(topo.psAddress);
+            if(!coordinators.empty()){
+                app->SetCoordinators(coordinators, w);
+            }
+        }else{
+            app->SetRing(nWorkers, topo.workerAddress[(w + 1) % nWorkers]);
+            uint32_t flow = flowCounter.Add(topo.workerAddress[(w + nWorkers - 1) % nWorkers], topo.workerAddress[w], port);
+            app->TraceConnectWithoutContext("PeerRx", Callback<void, uint32_t, Ptr<const Packet>, const Address&>([flow](uint32_t, Ptr<const Packet> packet, const Address& from){
+                flowCounter.Count(flow, packet->GetSize(), from);
+            }));
+        }
+        app->TraceConnectWithoutContext("Iteration", Callback<void, uint32_t, Time, Time, Time, Time>([w](uint32_t iteration, Time start, Time firstSend, Time computeEnd, Time commEnd){
+            LogIteration(w, iteration, start, firstSend, computeEnd, commEnd);
+        }));
+        app->TraceConnectWithoutContext("Transfer", Callback<void, uint32_t, Time, Time, uint64_t>([](uint32_t, Time start, Time end, uint64_t){
+            runStats.AddTransfer(start, end);
+        }));
+        topo.workers.Get(w)->AddApplication(app);
+        app->SetStartTime(Seconds(startTime));
+        app->SetStopTime(Seconds(stopTime));
+        trainingWorkers.push_back(app);
+    }
 }
 
-void LogThroughput(Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier){
-    monitor->CheckForLostPackets();
-    FlowMonitor::FlowStatsContainer stats = monitor->GetFlowStats();
-    for(std::map<FlowId, FlowMonitor::FlowStats>::const_iterator i = stats.begin(); i != stats.end(); i++){
-        Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow(i->first);
-        if(TotalRxBytes.find(i->first) == TotalRxBytes.end()){
-            TotalRxBytes[i->first] = 0;
+// Packets each switch hashed onto each of its uplinks (fabric routing)
+void LogEcmp(const std::string& path, bool binary, const std::vector<Ptr<FabricRouting>>& fabricRouting){
+    TraceWriter ecmp;
+    ecmp.Open(path, {{"Switch", TraceWriter::U32}, {"Level", TraceWriter::U32}, {"Uplink", TraceWriter::U32}, {"Packets", TraceWriter::U64}}, binary, 4096);
+    for(const Ptr<FabricRouting>& routing : fabricRouting){
+        const FabricSwitch& fabric = routing->GetSwitch();
+        if(!IsLocal(fabric.node)){
+            continue;
+        }
+        const std::vector<uint64_t>& packets = routing->GetUplinkPackets();
+        for(uint32_t u = 0; u < packets.size(); u++){
+            ecmp.Append(fabric.node->GetId(), fabric.level, u, packets[u]);
         }
-        uint32_t rxBytes = i->second.rxBytes - TotalRxBytes[i->first];
-        TotalRxBytes[i->first] = i->second.rxBytes;
-        // Bytes sent during 100 ms interval, throughput in Mbps
-        double throughput_ = (rxBytes * 8.0) / 1e5;
-        throughput << Simulator::Now().GetMilliSeconds() << "," << t.sourceAddress << "," << t.sourcePort << "," << t.destinationAddress << "," << t.destinationPort << "," << throughput_ << "\n";
     }
-
-    Simulator::Schedule(MilliSeconds(100), &LogThroughput, monitor, classifier);
+    ecmp.Close();
 }
 
-int main(){
-    // Create nodes
-    NodeContainer worker, ps, router, background;
-    worker.Create(2);
-    ps.Create(1);
-    router.Create(2);
-    background.Create(4);
-
-    Config::SetDefault("ns3::TcpL4Protocol::SocketType", StringValue("ns3::TcpCubic"));
-    Config::SetDefault("ns3::TcpSocket::InitialCwnd", UintegerValue(10));
-    Config::SetDefault("ns3::TcpSocket::SegmentSize", UintegerValue(1448));
-    Config::SetDefault("ns3::TcpSocket::DelAckCount", UintegerValue(1));
-    GlobalValue::Bind("ChecksumEnabled", BooleanValue(true));
-
-    // Create links
-    PointToPointHelper p2p;
-    p2p.SetDeviceAttribute("DataRate", StringValue("1Gbps"));
-    p2p.SetChannelAttribute("Delay", StringValue("200us"));
-    p2p.SetQueue("ns3::DropTailQueue", "MaxSize", StringValue("100p"));
-
-    // Connect nodes
-    NetDeviceContainer w1r1, w2r1, r1r2, psr2, b1r1, b2r1, b3r2, b4r2;
-    w1r1 = p2p.Install(router.Get(0), worker.Get(0));
-    w2r1 = p2p.Install(router.Get(0), worker.Get(1));
-
-    r1r2 = p2p.Install(router.Get(0), router.Get(1));
+// On/off senders send for their on time whatever their rate, so a notified
+// worker also gets a longer on time (and a shorter off time, keeping its
+// period) to offer the same bytes as at the nominal rate
+void PaceOnOffWorker(Ptr<Application> sender, DataRate nominal, double onTime, double offTime, DataRate rate){
+    double stretched = onTime * nominal.GetBitRate() / rate.GetBitRate();
+    sender->SetAttribute("DataRate", DataRateValue(rate));
+    sender->SetAttribute("OnTime", StringValue("ns3::ConstantRandomVariable[Constant=" + std::to_string(stretched) + "]"));
+    sender->SetAttribute("OffTime", StringValue("ns3::ConstantRandomVariable[Constant=" + std::to_string(std::max(0.0, onTime + offTime - stretched)) + "]"));
+}
 
-    psr2 = p2p.Install(router.Get(1), ps.Get(0));
+// Bytes each on/off worker handed to TCP per burst, so runs with and without
+// --pcn can be compared at equal load
+struct WorkerBurst {
+    Time start;
+    Time last;
+    uint64_t bytes = 0;
+};
+std::vector<WorkerBurst> workerBursts;
+
+void LogBurst(uint32_t worker){
+    WorkerBurst& burst = workerBursts[worker];
+    if(burst.bytes > 0){
+        burstLog.Append(worker, burst.start.GetMilliSeconds(), burst.last.GetMilliSeconds(), burst.bytes);
+    }
+    burst.bytes = 0;
+}
 
-    b1r1 = p2p.Install(router.Get(0), background.Get(0));
-    b2r1 = p2p.Install(router.Get(0), background.Get(1));
+void LogPcnNotify(Ipv4Address source, DataRate rate, Time burstStart, Time until){
+    pcnLog.Append(Simulator::Now().GetMilliSeconds(), source.Get(), rate.GetBitRate() / 1e6, burstStart.GetMilliSeconds(), until.GetMilliSeconds());
+}
 
-    b3r2 = p2p.Install(router.Get(1), background.Get(2));
-    b4r2 = p2p.Install(router.Get(1), background.Get(3));
+int main(int argc, char* argv[]){
+    TopologyConfig topoConfig;
+    TransportConfig transport;
+    AqmConfig aqm;
+    std::string scenario;
+    std::string suffix;
+    uint32_t workerRate = 900;
+    uint32_t backgroundRate = 100;
+    uint32_t crossRate = 175;
+    uint32_t packetSize = 1500;
+    double backgroundStart = 0.5;
+    double onTime = 1;
+    double offTime = 1;
+    double simTime = 50;
+    std::string outDir = ".";
+    bool distributed = false;
+    bool pcn = false;
+    uint32_t queueInterval = 100;
+    bool queueTraceFull = false;
+    bool traceAllQueues = false;
+    std::string traceFormat = "csv";
+    std::string app = "onoff";
+    std::string sender = "onoff";
+    double progressInterval = 1;
+    bool progress = false;
+    uint32_t ecmpSeed = 1;
+    std::string model = "resnet50";
+    double computeTime = 0;
+    uint32_t iterations = 0;
+    double gradientScale = 1;
+    CommSchedule schedule;
+    double workerStagger = 0;
+    std::string probeMetrics = "";
+    std::string probeNodes = "workers,ps";
+    uint32_t probeFlows = 4096;
+    bool stats = true;
+    // --RngRun selects the random stream for replicated runs
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("scenario", "File of key=value flags (see scenarios/); flags on the command line override it", scenario);
+    cmd.AddValue("suffix", "Suffix of every output file name, e.g. _ECN", suffix);
+    cmd.AddValue("topology", "dumbbell, fattree or leafspine", topoConfig.type);
+    cmd.AddValue("k", "Fat-tree arity", topoConfig.k);
+    cmd.AddValue("leaves", "Leaf-spine: number of leaves", topoConfig.leaves);
+    cmd.AddValue("spines", "Leaf-spine: number of spines", topoConfig.spines);
+    cmd.AddValue("oversubscription", "Host to fabric capacity ratio at each ToR", topoConfig.oversubscription);
+    cmd.AddValue("workers", "Number of workers (fabric topologies)", topoConfig.nWorkers);
+    cmd.AddValue("ps", "Number of parameter servers (fabric topologies)", topoConfig.nPs);
+    cmd.AddValue("linkRate", "Link data rate", topoConfig.linkRate);
+    cmd.AddValue("linkDelay", "Link propagation delay", topoConfig.linkDelay);
+    cmd.AddValue("routing", "global (all-pairs shortest path), fabric (structural with per-flow ECMP) or nix (on-demand Nix vectors)", topoConfig.routing);
+    cmd.AddValue("ecmpSeed", "Seed of the fabric routing ECMP hash", ecmpSeed);
+    cmd.AddValue("transport", "TCP congestion control: cubic, dctcp, bbr, newreno, ... or an ns3::Tcp* type id", transport.tcp);
+    cmd.AddValue("ecn", "ECN marking in the AQM and ECN negotiation in TCP", transport.ecn);
+    cmd.AddValue("segmentSize", "TCP segment size in bytes", transport.segmentSize);
+    cmd.AddValue("initialCwnd", "TCP initial congestion window in segments", transport.initialCwnd);
+    cmd.AddValue("delAckCount", "TCP segments per delayed ACK", transport.delAckCount);
+    cmd.AddValue("aqm", "Switch queue disc: pfifo, red, codel, fqcodel, pie, fqpie or dynecn", aqm.type);
+    cmd.AddValue("queueLimit", "Switch queue disc limit in packets", aqm.limit);
+    cmd.AddValue("redMinTh", "RED minimum threshold in packets", aqm.redMinTh);
+    cmd.AddValue("redMaxTh", "RED maximum threshold in packets", aqm.redMaxTh);
+    cmd.AddValue("redQw", "RED queue weight", aqm.redQw);
+    cmd.AddValue("aqmTarget", "CoDel/FqCoDel target, PIE delay reference or dynecn target delay, e.g. 5ms (empty: default)", aqm.target);
+    cmd.AddValue("aqmInterval", "CoDel/FqCoDel interval, PIE or dynecn update period, e.g. 100ms (empty: default)", aqm.interval);
+    cmd.AddValue("workerRate", "Worker OnOff data rate in Mbps", workerRate);
+    cmd.AddValue("onTime", "Worker on time in seconds", onTime);
+    cmd.AddValue("offTime", "Worker off time in seconds", offTime);
+    cmd.AddValue("backgroundRate", "Background OnOff data rate in Mbps", backgroundRate);
+    cmd.AddValue("crossRate", "Dumbbell: rate of the background flows across the bottleneck in Mbps", crossRate);
+    cmd.AddValue("backgroundStart", "Start of the background flows in seconds", backgroundStart);
+    cmd.AddValue("packetSize", "OnOff packet size in bytes", packetSize);
+    cmd.AddValue("simTime", "Simulated time in seconds", simTime);
+    cmd.AddValue("outDir", "Directory for the output CSVs", outDir);
+    cmd.AddValue("app", "Worker traffic: onoff, ps (parameter server training) or ring (ring all-reduce training)", app);
+    cmd.AddValue("sender", "OnOff sender application: onoff (per-packet events) or paced (chunked, see DDL-PacedSender.h)", sender);
+    cmd.AddValue("model", "Training model profile: resnet50, bert or vgg16", model);
+    cmd.AddValue("computeTime", "Training forward plus backward time per iteration in ms (0: model default)", computeTime);
+    cmd.AddValue("iterations", "Training iterations per worker (0: until simTime)", iterations);
+    cmd.AddValue("gradientScale", "Scale of the gradient tensors, e.g. 0.5 for fp16", gradientScale);
+    cmd.AddValue("chunkSize", "Parameter server training: push gradients in chunks of this many bytes, first layer first (0: off)", schedule.chunkSize);
+    cmd.AddValue("pushTokens", "Parameter server training: workers pushing to a PS at the same time, with per-layer replies (0: no coordination)", schedule.tokens);
+    cmd.AddValue("priority", "Mark training traffic DSCP EF and serve it from a priority band at the switches", schedule.priority);
+    cmd.AddValue("workerStagger", "On/off workers: start offset between successive workers in seconds, modulo the on/off period (0: synchronized)", workerStagger);
+    cmd.AddValue("queueInterval", "Queue summary interval in ms", queueInterval);
+    cmd.AddValue("queueTraceFull", "Also write every queue transition", queueTraceFull);
+    cmd.AddValue("traceAllQueues", "Trace every switch port, not only the two bottlenecks", traceAllQueues);
+    cmd.AddValue("traceFormat", "csv or binary (buffered columnar .ddlt, see tracereader.py)", traceFormat);
+    cmd.AddValue("progressInterval", "Simulated seconds between profiler samples in run_report<suffix>.json (0: none)", progressInterval);
+    cmd.AddValue("progress", "Print a progress line with events/s and sim/wall ratio at every profiler sample", progress);
+    cmd.AddValue("flowProbe", "Per-flow metrics to record on the probed hosts: comma separated rx, delay, loss (empty: off)", probeMetrics);
+    cmd.AddValue("probeNodes", "Hosts carrying flow probes: comma separated workers, ps, background", probeNodes);
+    cmd.AddValue("probeFlows", "Flow probe table size (flows beyond it are not recorded)", probeFlows);
+    cmd.AddValue("stats", "Write streaming FCT, queueing delay and queue length percentiles to stats<suffix>.json", stats);
+    cmd.AddValue("pcn", "Use proactive congestion notification queue discs and worker rate control", pcn);
+    cmd.AddValue("distributed", "Partition the topology over MPI ranks (run under mpirun)", distributed);
+    cmd.Parse(ScenarioArgs(argc, argv));
+    topoConfig.ranks = StartDistributed(distributed, &argc, &argv);
+    if(pcn && topoConfig.ranks > 1){
+        NS_FATAL_ERROR("--pcn notifies workers directly and cannot be combined with --distributed");
+    }
+    if(schedule.tokens > 0 && topoConfig.ranks > 1){
+        NS_FATAL_ERROR("--pushTokens coordinates workers directly and cannot be combined with --distributed");
+    }
+    if(pcn && schedule.priority){
+        NS_FATAL_ERROR("--pcn and --priority both replace the switch queue discs");
+    }
+    SystemPath::MakeDirectories(outDir);
+    if(traceFormat != "csv" && traceFormat != "binary"){
+        NS_FATAL_ERROR("Unknown trace format " << traceFormat);
+    }
+    if(app != "onoff" && app != "ps" && app != "ring"){
+        NS_FATAL_ERROR("Unknown worker app " << app);
+    }
+    if(sender == "paced"){
+        senderType = "ns3::PacedBulkApplication";
+    }else if(sender != "onoff"){
+        NS_FATAL_ERROR("Unknown sender " << sender);
+    }
+    bool binaryTraces = traceFormat == "binary";
+    std::string ext = TraceWriter::Extension(binaryTraces);
 
-    // Install internet stack
-    InternetStackHelper stack;
-    stack.Install(worker);
-    stack.Install(ps);
-    stack.Install(router);
-    stack.Install(background);
+    ConfigureTransport(transport);
+    GlobalValue::Bind("ChecksumEnabled", BooleanValue(true));
 
-    // Install Traffic Control for observing queue sizes
+    // Traffic control on the switch ports for observing queue sizes
     TrafficControlHelper tch;
-    tch.SetRootQueueDisc("ns3::PfifoFastQueueDisc", "MaxSize", StringValue("100p"));
-    
-    QueueDiscContainer qd1 = tch.Install(r1r2);
-    QueueDiscContainer qd2 = tch.Install(psr2);
-
-    // Assign IP addresses
-    Ipv4AddressHelper address;
-    address.SetBase("192.168.1.0","255.255.255.0");
-    Ipv4InterfaceContainer w1r1Iface = address.Assign(w1r1);
-
-    address.SetBase("192.168.2.0","255.255.255.0");
-    Ipv4InterfaceContainer w2r1Iface = address.Assign(w2r1);
-
-    address.SetBase("192.168.3.0","255.255.255.0");
-    Ipv4InterfaceContainer psr2Iface = address.Assign(psr2);
-
-    address.SetBase("192.168.4.0","255.255.255.0");
-    Ipv4InterfaceContainer r1r2Iface = address.Assign(r1r2);
-
-    address.SetBase("192.168.5.0","255.255.255.0");
-    Ipv4InterfaceContainer b1r1Iface = address.Assign(b1r1);
-
-    address.SetBase("192.168.6.0","255.255.255.0");
-    Ipv4InterfaceContainer b2r1Iface = address.Assign(b2r1);
-
-    address.SetBase("192.168.7.0","255.255.255.0");
-    Ipv4InterfaceContainer b3r2Iface = address.Assign(b3r2);
-
-    address.SetBase("192.168.8.0","255.255.255.0");
-    Ipv4InterfaceContainer b4r2Iface = address.Assign(b4r2);
-
-    Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    ConfigureAqm(tch, aqm, transport.ecn, pcn, schedule.priority, topoConfig.linkRate, topoConfig.linkDelay);
+
+    // Create nodes, links and addresses
+    DdlTopology topo = BuildTopology(topoConfig, tch);
+
+    std::vector<Ptr<FabricRouting>> fabricRouting;
+    double routingSeconds = InstallRouting(topoConfig, topo, ecmpSeed, fabricRouting);
+
+    // Flow probes on the selected end hosts only
+    flowProbe.Configure(probeMetrics, probeFlows);
+    if(flowProbe.IsEnabled()){
+        std::string rest = probeNodes;
+        while(!rest.empty()){
+            size_t comma = rest.find(',');
+            std::string group = rest.substr(0, comma);
+            rest = comma == std::string::npos ? "" : rest.substr(comma + 1);
+            NodeContainer hosts;
+            if(group == "workers"){
+                hosts = topo.workers;
+            }else if(group == "ps"){
+                hosts = topo.ps;
+            }else if(group == "background"){
+                hosts = topo.background;
+            }else if(!group.empty()){
+                NS_FATAL_ERROR("Unknown probe node group " << group << " (workers, ps or background)");
+            }
+            for(uint32_t i = 0; i < hosts.GetN(); i++){
+                flowProbe.Install(hosts.Get(i));
+            }
+        }
+    }
 
     // Create flows
     uint16_t port = 9;
-    // Worker 1 to PS
-    createApps(InetSocketAddress(psr2Iface.GetAddress(1), port), worker.Get(0), ps.Get(0), 900, 1500, 0.0, 50.0, 1, 1);
-    // Worker 2 to PS
-    createApps(InetSocketAddress(psr2Iface.GetAddress(1), port+1), worker.Get(1), ps.Get(0), 900, 1500, 0.0, 50.0, 1, 1);
-    // Background 1 to background 2 and background 3 to background 4
-    createBackgroundApps(InetSocketAddress(b2r1Iface.GetAddress(1), port), background.Get(0), background.Get(1), 100, 1500, 0.5, 50.0, 1, 0);
-    createBackgroundApps(InetSocketAddress(b4r2Iface.GetAddress(1), port), background.Get(3), background.Get(2), 100, 1500, 0.5, 50.0, 1, 0);
-
-    // // Background 1 to background 3, 4
-    port++;
-    createBackgroundApps(InetSocketAddress(b3r2Iface.GetAddress(1), port), background.Get(0), background.Get(2), 175, 1500, 0.5, 50.0, 1, 0);
-    createBackgroundApps(InetSocketAddress(b4r2Iface.GetAddress(1), port), background.Get(0), background.Get(3), 175, 1500, 0.5, 50.0, 1, 0);
-
-    // // Background 2 to background 3, 4
-    port++;
-    createBackgroundApps(InetSocketAddress(b3r2Iface.GetAddress(1), port), background.Get(1), background.Get(2), 175, 1500, 0.5, 50.0, 1, 0);
-    createBackgroundApps(InetSocketAddress(b4r2Iface.GetAddress(1), port), background.Get(1), background.Get(3), 175, 1500, 0.5, 50.0, 1, 0);
-
-
-    q1Size.open("q1Size.csv");
-    q1Size << "Time(ms),QueueSize(Packets)\n";
+    if(app != "onoff"){
+        if(app == "ring" && topo.workers.GetN() < 2){
+            NS_FATAL_ERROR("Ring all-reduce needs at least two workers");
+        }
+        iterationLog.Open(RankPath(outDir + "/iteration" + suffix + ext), {{"Worker", TraceWriter::U32}, {"Iteration", TraceWriter::U32}, {"Start(ms)", TraceWriter::F64}, {"ComputeEnd(ms)", TraceWriter::F64}, {"CommEnd(ms)", TraceWriter::F64}, {"IterationTime(ms)", TraceWriter::F64}, {"ExposedComm(ms)", TraceWriter::F64}, {"Overlap", TraceWriter::F64}}, binaryTraces, 1024);
+        createTrainingApps(topo, app, GetModelProfile(model, gradientScale), schedule, Seconds(computeTime / 1e3), iterations, 0.0, simTime);
+    }else if(topoConfig.type == "dumbbell"){
+        // Worker 1 to PS
+        createApps(InetSocketAddress(topo.psAddress[0], port), topo.workers.Get(0), topo.ps.Get(0), workerRate, packetSize, 0.0, simTime, onTime, offTime);
+        // Worker 2 to PS
+        createApps(InetSocketAddress(topo.psAddress[0], port+1), topo.workers.Get(1), topo.ps.Get(0), workerRate, packetSize, std::fmod(workerStagger, onTime + offTime), simTime, onTime, offTime);
+    }else{
+        // Every worker pushes to one PS, PSs shared round robin
+        for(uint32_t i = 0; i < topo.workers.GetN(); i++){
+            uint32_t ps = i % topo.ps.GetN();
+            createApps(InetSocketAddress(topo.psAddress[ps], port + i), topo.workers.Get(i), topo.ps.Get(ps), workerRate, packetSize, std::fmod(i * workerStagger, onTime + offTime), simTime, onTime, offTime);
+        }
+    }
+    if(topoConfig.type == "dumbbell"){
+        // Background 1 to background 2 and background 3 to background 4
+        createBackgroundApps(InetSocketAddress(topo.backgroundAddress[1], port), topo.background.Get(0), topo.background.Get(1), backgroundRate, packetSize, backgroundStart, simTime, 1, 0);
+        createBackgroundApps(InetSocketAddress(topo.backgroundAddress[3], port), topo.background.Get(3), topo.background.Get(2), backgroundRate, packetSize, backgroundStart, simTime, 1, 0);
+
+        // // Background 1 to background 3, 4
+        port++;
+        createBackgroundApps(InetSocketAddress(topo.backgroundAddress[2], port), topo.background.Get(0), topo.background.Get(2), crossRate, packetSize, backgroundStart, simTime, 1, 0);
+        createBackgroundApps(InetSocketAddress(topo.backgroundAddress[3], port), topo.background.Get(0), topo.background.Get(3), crossRate, packetSize, backgroundStart, simTime, 1, 0);
+
+        // // Background 2 to background 3, 4
+        port++;
+        createBackgroundApps(InetSocketAddress(topo.backgroundAddress[2], port), topo.background.Get(1), topo.background.Get(2), crossRate, packetSize, backgroundStart, simTime, 1, 0);
+        createBackgroundApps(InetSocketAddress(topo.backgroundAddress[3], port), topo.background.Get(1), topo.background.Get(3), crossRate, packetSize, backgroundStart, simTime, 1, 0);
+    }else{
+        // Background hosts send to the host half the background set away
+        uint32_t nBackground = topo.background.GetN();
+        for(uint32_t i = 0; nBackground > 1 && i < nBackground; i++){
+            uint32_t dest = (i + nBackground / 2) % nBackground;
+            createBackgroundApps(InetSocketAddress(topo.backgroundAddress[dest], port), topo.background.Get(i), topo.background.Get(dest), backgroundRate, packetSize, backgroundStart, simTime, 1, 0);
+        }
+    }
 
-    q2Size.open("q2Size.csv");
-    q2Size << "Time(ms),QueueSize(Packets)\n";
+    // Bytes per on/off worker burst; a silence of half the off time ends one
+    if(app == "onoff"){
+        burstLog.Open(RankPath(outDir + "/bursts" + suffix + ext), {{"Worker", TraceWriter::U32}, {"Start(ms)", TraceWriter::U64}, {"End(ms)", TraceWriter::U64}, {"Bytes", TraceWriter::U64}}, binaryTraces, 256);
+        workerBursts.resize(topo.workers.GetN());
+        Time gap = offTime > 0 ? Seconds(offTime / 2) : Seconds(simTime);
+        for(uint32_t i = 0; i < topo.workers.GetN(); i++){
+            if(onOffApps[i].GetN() == 0){
+                continue;
+            }
+            onOffApps[i].Get(0)->TraceConnectWithoutContext("Tx", Callback<void, Ptr<const Packet>>([i, gap](Ptr<const Packet> packet){
+                WorkerBurst& burst = workerBursts[i];
+                Time now = Simulator::Now();
+                if(burst.bytes > 0 && now - burst.last > gap){
+                    LogBurst(i);
+                }
+                if(burst.bytes == 0){
+                    burst.start = now;
+                }
+                burst.bytes += packet->GetSize();
+                burst.last = now;
+            }));
+        }
+    }
 
-    throughput.open("throughput.csv");
-    throughput << "Time(ms),Source IP, Source Port, Dest IP, Dest Port,Throughput(Mbps)\n";
+    // Proactive congestion notification: each worker's rate controller is
+    // registered with every PCN queue disc so any hop can pace it
+    if(pcn){
+        pcnLog.Open(RankPath(outDir + "/pcn" + suffix + ext), {{"Time(ms)", TraceWriter::U64}, {"Source IP", TraceWriter::IPV4}, {"Rate(Mbps)", TraceWriter::F64}, {"BurstStart(ms)", TraceWriter::U64}, {"Until(ms)", TraceWriter::U64}}, binaryTraces, 256);
+        for(uint32_t i = 0; i < topo.workers.GetN(); i++){
+            Ptr<PcnRateController> controller;
+            if(app == "onoff"){
+                Ptr<Application> sender = onOffApps[i].Get(0);
+                DataRate nominal(workerRate * 1000000ULL);
+                controller = CreateObjectWithAttributes<PcnRateController>("NominalRate", DataRateValue(nominal));
+                controller->SetRateCallback(Callback<void, DataRate>([sender, nominal, onTime, offTime](DataRate rate){
+                    PaceOnOffWorker(sender, nominal, onTime, offTime, rate);
+                }));
+            }else{
+                // Training workers are unpaced (rate 0) unless notified
+                Ptr<DdlWorkerApp> worker = trainingWorkers[i];
+                controller = CreateObjectWithAttributes<PcnRateController>("NominalRate", DataRateValue(DataRate(0)));
+                controller->SetRateCallback(Callback<void, DataRate>([worker](DataRate rate){
+                    worker->SetRate(rate);
+                }));
+            }
+            for(uint32_t q = 0; q < topo.switchQueues.GetN(); q++){
+                DynamicCast<PcnQueueDisc>(topo.switchQueues.Get(q))->AddSender(topo.workerAddress[i], controller);
+            }
+        }
+        for(uint32_t q = 0; q < topo.switchQueues.GetN(); q++){
+            topo.switchQueues.Get(q)->TraceConnectWithoutContext("Notify", MakeCallback(&LogPcnNotify));
+        }
+    }
 
-    FlowMonitorHelper flowmon;
-    Ptr<FlowMonitor> monitor = flowmon.InstallAll();
-    Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier());
+    // Queue occupancy from the queue disc trace sources
+    std::vector<std::string> traceFiles;
+    std::vector<std::unique_ptr<TraceWriter>> thresholdLogs;
+    QueueTracer queueTracer(MilliSeconds(queueInterval), queueTraceFull, binaryTraces);
+    auto traceQueue = [&](Ptr<QueueDisc> disc, Ptr<Node> node, std::string name){
+        std::string summaryPath = outDir + "/" + name + "Size" + suffix + ext;
+        std::string tracePath = outDir + "/" + name + "Trace" + suffix + ext;
+        traceFiles.push_back(summaryPath);
+        if(queueTraceFull){
+            traceFiles.push_back(tracePath);
+        }
+        if(IsLocal(node)){
+            queueTracer.Add(disc, RankPath(summaryPath), RankPath(tracePath));
+            if(stats){
+                runStats.AddQueue(disc, name);
+            }
+        }
+        // Dynamic ECN: the threshold and what it was computed from
+        if(DynamicCast<DynamicEcnQueueDisc>(disc)){
+            std::string thresholdPath = outDir + "/" + name + "Threshold" + suffix + ext;
+            traceFiles.push_back(thresholdPath);
+            if(IsLocal(node)){
+                thresholdLogs.push_back(std::make_unique<TraceWriter>());
+                TraceWriter* log = thresholdLogs.back().get();
+                log->Open(RankPath(thresholdPath), {{"Time(ns)", TraceWriter::U64}, {"DrainRate(Mbps)", TraceWriter::F64}, {"ActiveFlows", TraceWriter::F64}, {"Threshold(Packets)", TraceWriter::U32}}, binaryTraces, 1024);
+                disc->TraceConnectWithoutContext("Update", Callback<void, DataRate, double, uint32_t>([log](DataRate rate, double flows, uint32_t threshold){
+                    log->Append(Simulator::Now().GetNanoSeconds(), rate.GetBitRate() / 1e6, flows, threshold);
+                }));
+            }
+        }
+    };
+    traceQueue(topo.bottlenecks.front(), topo.bottleneckNodes.front(), "q1");
+    traceQueue(topo.bottlenecks.back(), topo.bottleneckNodes.back(), "q2");
+    if(traceAllQueues){
+        for(uint32_t q = 0; q < topo.switchQueues.GetN(); q++){
+            traceQueue(topo.switchQueues.Get(q), topo.switchQueueNodes[q], "port" + std::to_string(q));
+        }
+    }
 
-    Simulator::Schedule(MilliSeconds(100), &LogQueue1Size, qd1.Get(0));
-    Simulator::Schedule(MilliSeconds(100), &LogQueue2Size, qd2.Get(0));
-    Simulator::Schedule(MilliSeconds(100), &LogThroughput, monitor, classifier);
+    throughput.Open(RankPath(outDir + "/throughput" + suffix + ext), {{"Time(ms)", TraceWriter::U64}, {"Source IP", TraceWriter::IPV4}, {" Source Port", TraceWriter::U32}, {" Dest IP", TraceWriter::IPV4}, {" Dest Port", TraceWriter::U32}, {"Throughput(Mbps)", TraceWriter::F64}}, binaryTraces);
+
+    // Per-flow throughput every 100 ms from the sink counters
+    queueTracer.Start();
+    flowCounter.Start(MilliSeconds(100), &throughput);
+
+    // Run report: what the events and the wall time were spent on
+    profiler.SetInfo("program", "DDL-Congestion");
+    profiler.SetInfo("scenario", scenario);
+    profiler.SetInfo("transport", transport.tcp);
+    profiler.SetInfo("aqm", pcn ? "pcn" : aqm.type);
+    profiler.SetInfo("topology", topoConfig.type);
+    profiler.SetInfo("app", app);
+    profiler.SetInfo("sender", sender);
+    profiler.SetInfo("routing", topoConfig.routing);
+    profiler.SetValue("rng_seed", RngSeedManager::GetSeed());
+    profiler.SetValue("rng_run", RngSeedManager::GetRun());
+    profiler.SetValue("ranks", RankCount());
+    profiler.SetValue("rank", LocalRank());
+    profiler.SetValue("hosts", topo.nHosts);
+    profiler.SetValue("switches", topo.switches.GetN());
+    profiler.SetValue("links", topo.nLinks);
+    profiler.SetValue("flows", flowCounter.GetNFlows());
+    profiler.SetValue("setup_seconds", topo.setupSeconds);
+    profiler.SetValue("routing_seconds", routingSeconds);
+    profiler.SetValue("setup_peak_rss_kb", topo.peakRssKb);
+    for(const ApplicationContainer& senders : onOffApps){
+        for(uint32_t i = 0; i < senders.GetN(); i++){
+            // OnOff sends one event per packet; paced chunks ride on other events.
+            // Tx only fires for packets the socket took, so send attempts
+            // refused by a full send buffer stay in "other"
+            uint64_t& sends = sender == "onoff" ? profiler.EventCounter("app_sends_ok") : profiler.Counter("app_chunks");
+            senders.Get(i)->TraceConnectWithoutContext("Tx", Callback<void, Ptr<const Packet>>([&sends](Ptr<const Packet>){
+                sends++;
+            }));
+        }
+    }
 
-    Simulator::Stop(Seconds(50.0));
+    Simulator::Stop(Seconds(simTime));
+    profiler.Start(Seconds(progressInterval), progress && LocalRank() == 0);
     Simulator::Run();
+    profiler.Stop();
+    for(uint32_t i = 0; i < workerBursts.size(); i++){
+        LogBurst(i);
+    }
+    double runSeconds = profiler.GetRunSeconds();
+    if(LocalRank() == 0){
+        std::cout << "Simulation wall time " << runSeconds << " s on " << RankCount() << " rank(s), " << profiler.GetEvents() << " events" << std::endl;
+    }
+    profiler.EventCounter("queue_log_ticks") = queueTracer.GetTicks();
+    profiler.EventCounter("throughput_ticks") = flowCounter.GetTicks();
+    profiler.Counter("queue_transitions") = queueTracer.GetTransitions();
+    profiler.Counter("probe_packets") = flowProbe.GetPackets();
+    profiler.SetValue("queue_callback_wall_seconds", queueTracer.GetCallbackSeconds());
+    if(!fabricRouting.empty()){
+        LogEcmp(RankPath(outDir + "/ecmp" + suffix + ext), binaryTraces, fabricRouting);
+        traceFiles.push_back(outDir + "/ecmp" + suffix + ext);
+    }
+    if(stats){
+        runStats.Write(RankReportPath(outDir + "/stats" + suffix + ".json"));
+    }
+    if(flowProbe.IsEnabled()){
+        // Rank 0 merges the per-rank tables itself
+        flowProbe.Write(outDir + "/flowstats" + suffix + ext, binaryTraces);
+    }
 
+    auto teardownStart = std::chrono::steady_clock::now();
     Simulator::Destroy();
 
-    q1Size.close();
-    q2Size.close();
-    throughput.close();
+    queueTracer.Close();
+    throughput.Close();
+    pcnLog.Close();
+    burstLog.Close();
+    for(auto& log : thresholdLogs){
+        log->Close();
+    }
+    iterationLog.Close();
+    profiler.SetValue("teardown_seconds", std::chrono::duration<double>(std::chrono::steady_clock::now() - teardownStart).count());
+    profiler.Write(RankReportPath(outDir + "/run_report" + suffix + ".json"));
+    traceFiles.push_back(outDir + "/throughput" + suffix + ext);
+    if(app != "onoff"){
+        traceFiles.push_back(outDir + "/iteration" + suffix + ext);
+    }else{
+        traceFiles.push_back(outDir + "/bursts" + suffix + ext);
+    }
+    GatherTraces(traceFiles);
+    StopDistributed();
 }
\ No newline at end of file
@@ -0,0 +1,195 @@
+#ifndef DDL_DISTRIBUTED_H
+#define DDL_DISTRIBUTED_H
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+#ifdef NS3_MPI
+#include <mpi.h>
+#include "ns3/mpi-interface.h"
+#endif
+
+using namespace ns3;
+
+// Optional distributed (MPI) mode for the DDL-Congestion programs.
+//
+// With --distributed the programs run under ns3::DistributedSimulatorImpl,
+// one logical process per MPI rank. The topology builder spreads nodes over
+// ranks (dumbbell: one rank per router side; fat-tree: pods and core switches
+// round robin; leaf-spine: leaves and spines round robin) and every link
+// between ranks becomes a remote point-to-point channel, so its delay (200us
+// by default) is the lookahead. Applications, queue logging and flow
+// monitoring only run on the rank that owns the node; each rank writes its
+// own part of every trace file and rank 0 merges them by time at the end.
+//
+// Needs ns-3 configured with --enable-mpi; run on one machine with e.g.
+//   mpirun -np 2 ./build/scratch/ns3.43-DDL-Congestion-default --distributed
+
+// Enables MPI when requested and returns the number of ranks.
+inline uint32_t StartDistributed(bool distributed, int* argc, char*** argv){
+    if(!distributed){
+        return 1;
+    }
+#ifdef NS3_MPI
+    GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::DistributedSimulatorImpl"));
+    MpiInterface::Enable(argc, argv);
+    return MpiInterface::GetSize();
+#else
+    NS_FATAL_ERROR("--distributed needs ns-3 built with --enable-mpi");
+    return 1;
+#endif
+}
+
+inline uint32_t LocalRank(){
+#ifdef NS3_MPI
+    if(MpiInterface::IsEnabled()){
+        return MpiInterface::GetSystemId();
+    }
+#endif
+    return 0;
+}
+
+inline uint32_t RankCount(){
+#ifdef NS3_MPI
+    if(MpiInterface::IsEnabled()){
+        return MpiInterface::GetSize();
+    }
+#endif
+    return 1;
+}
+
+inline bool IsLocal(Ptr<Node> node){
+    return node->GetSystemId() == LocalRank();
+}
+
+inline NodeContainer LocalNodes(){
+    NodeContainer local;
+    for(NodeList::Iterator i = NodeList::Begin(); i != NodeList::End(); i++){
+        if(IsLocal(*i)){
+            local.Add(*i);
+        }
+    }
+    return local;
+}
+
+// Per-rank part of a trace file; the plain path when running sequentially.
+inline std::string RankPath(const std::string& path){
+    if(RankCount() == 1){
+        return path;
+    }
+    return path + ".rank" + std::to_string(LocalRank());
+}
+
+// Per-rank part of a JSON report, <name>.rank<N>.json. These are not merged
+// by GatherTraces; sweep.py combines them (see summarize_run).
+inline std::string RankReportPath(const std::string& path){
+    if(RankCount() == 1){
+        return path;
+    }
+    size_t dot = path.rfind('.');
+    return path.substr(0, dot) + ".rank" + std::to_string(LocalRank()) + path.substr(dot);
+}
+
+inline void Barrier(){
+#ifdef NS3_MPI
+    if(MpiInterface::IsEnabled()){
+        MPI_Barrier(MpiInterface::GetCommunicator());
+    }
+#endif
+}
+
+// Length of the header of a binary .ddlt trace (see DDL-TraceWriter.h).
+inline size_t BinaryTraceHeaderSize(const std::string& data){
+    if(data.size() < 12){
+        return data.size();
+    }
+    uint32_t columns;
+    std::memcpy(&columns, data.data() + 8, 4);
+    size_t pos = 12;
+    for(uint32_t c = 0; c < columns && pos + 3 <= data.size(); c++){
+        uint16_t length;
+        std::memcpy(&length, data.data() + pos + 1, 2);
+        pos += 3 + length;
+    }
+    return pos;
+}
+
+// Binary traces are merged by appending the blocks of every part after the
+// header of the first one; rows stay grouped per rank.
+inline void GatherBinaryTrace(const std::string& path){
+    std::ofstream out(path, std::ios::binary);
+    bool header = true;
+    for(uint32_t rank = 0; rank < RankCount(); rank++){
+        std::string part = path + ".rank" + std::to_string(rank);
+        std::ifstream in(part, std::ios::binary);
+        if(!in){
+            continue;
+        }
+        std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+        std::remove(part.c_str());
+        size_t skip = header ? 0 : BinaryTraceHeaderSize(data);
+        out.write(data.data() + skip, data.size() - skip);
+        header = false;
+    }
+}
+
+// Rank 0 merges the per-rank parts of each trace into one file. CSV parts
+// (header line plus rows starting with the time) are merged in time order.
+inline void GatherTraces(const std::vector<std::string>& paths){
+    if(RankCount() == 1){
+        return;
+    }
+    Barrier();
+    if(LocalRank() == 0){
+        for(const std::string& path : paths){
+            if(path.size() > 5 && path.compare(path.size() - 5, 5, ".ddlt") == 0){
+                GatherBinaryTrace(path);
+                continue;
+            }
+            std::string header;
+            std::vector<std::pair<double, std::string>> rows;
+            for(uint32_t rank = 0; rank < RankCount(); rank++){
+                std::string part = path + ".rank" + std::to_string(rank);
+                std::ifstream in(part);
+                std::string line;
+                if(std::getline(in, line)){
+                    header = line;
+                }
+                while(std::getline(in, line)){
+                    if(!line.empty()){
+                        rows.emplace_back(std::stod(line), line);
+                    }
+                }
+                in.close();
+                std::remove(part.c_str());
+            }
+            std::stable_sort(rows.begin(), rows.end(), [](const std::pair<double, std::string>& a, const std::pair<double, std::string>& b){
+                return a.first < b.first;
+            });
+            std::ofstream out(path);
+            out << header << "\n";
+            for(const auto& row : rows){
+                out << row.second << "\n";
+            }
+        }
+    }
+    Barrier();
+}
+
+inline void StopDistributed(){
+#ifdef NS3_MPI
+    if(MpiInterface::IsEnabled()){
+        MpiInterface::Disable();
+    }
+#endif
+}
+
+#endif
@@ -0,0 +1,245 @@
+#ifndef DDL_DYNAMIC_ECN_H
+#define DDL_DYNAMIC_ECN_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/traffic-control-module.h"
+
+// ECN marking with a threshold that follows the load.
+//
+// DynamicEcnQueueDisc is a FIFO queue disc that marks (or, without UseEcn,
+// drops) arriving packets once the queue holds Threshold packets, like DCTCP
+// style RED with MinTh == MaxTh, but recomputes the threshold every
+// UpdateInterval from what it measures instead of using a fixed one:
+//
+//   Threshold = Lambda * DrainRate * Rtt / MeanPktSize / sqrt(ActiveFlows)
+//
+// clamped to [MinThreshold, MaxThreshold]. DrainRate is an EWMA of the bytes
+// dequeued over the time the queue was backlogged (LinkBandwidth until the
+// first sample). ActiveFlows is estimated by linear counting: each packet
+// sets one bit of a FlowBits wide bitmap chosen by its 5-tuple hash, and at
+// the end of the interval n = -m ln(zero bits / m). Many desynchronized flows
+// need less queue to keep the link busy than a few synchronized ones, so the
+// threshold shrinks as flows are added and grows back for the lone elephant.
+//
+// With TargetDelay set it also marks when the backlog would take longer than
+// TargetDelay to drain at the measured rate, which bounds the queueing delay
+// when the drain rate drops.
+
+namespace ns3 {
+
+class DynamicEcnQueueDisc : public QueueDisc {
+public:
+    static constexpr const char* LIMIT_EXCEEDED_DROP = "Queue disc limit exceeded";
+    static constexpr const char* THRESHOLD_MARK = "Above dynamic threshold";
+    static constexpr const char* THRESHOLD_DROP = "Early drop above dynamic threshold";
+    static constexpr const char* DELAY_MARK = "Above target delay";
+    static constexpr const char* DELAY_DROP = "Early drop above target delay";
+
+    static TypeId GetTypeId(){
+        static TypeId tid = TypeId("ns3::DynamicEcnQueueDisc")
+            .SetParent<QueueDisc>()
+            .SetGroupName("TrafficControl")
+            .AddConstructor<DynamicEcnQueueDisc>()
+            .AddAttribute("MaxSize", "The max queue size",
+                          QueueSizeValue(QueueSize("100p")),
+                          MakeQueueSizeAccessor(&QueueDisc::SetMaxSize, &QueueDisc::GetMaxSize),
+                          MakeQueueSizeChecker())
+            .AddAttribute("UseEcn", "Mark ECN capable packets above the threshold instead of dropping them",
+                          BooleanValue(true),
+                          MakeBooleanAccessor(&DynamicEcnQueueDisc::m_useEcn),
+                          MakeBooleanChecker())
+            .AddAttribute("LinkBandwidth", "Drain rate assumed until the first measurement",
+                          DataRateValue(DataRate("1Gbps")),
+                          MakeDataRateAccessor(&DynamicEcnQueueDisc::m_linkBandwidth),
+                          MakeDataRateChecker())
+            .AddAttribute("Rtt", "Base round trip time of the flows through this queue",
+                          TimeValue(MilliSeconds(1)),
+                          MakeTimeAccessor(&DynamicEcnQueueDisc::m_rtt),
+                          MakeTimeChecker())
+            .AddAttribute("Lambda", "Share of the bandwidth-delay product kept as queue for a single flow",
+                          DoubleValue(0.17),
+                          MakeDoubleAccessor(&DynamicEcnQueueDisc::m_lambda),
+                          MakeDoubleChecker<double>(0.0))
+            .AddAttribute("MeanPktSize", "Packet size in bytes used to turn bytes into packets",
+                          UintegerValue(1500),
+                          MakeUintegerAccessor(&DynamicEcnQueueDisc::m_meanPktSize),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("MinThreshold", "Lowest marking threshold in packets",
+                          UintegerValue(5),
+                          MakeUintegerAccessor(&DynamicEcnQueueDisc::m_minThreshold),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("MaxThreshold", "Highest marking threshold in packets",
+                          UintegerValue(65),
+                          MakeUintegerAccessor(&DynamicEcnQueueDisc::m_maxThreshold),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("TargetDelay", "Also mark when the backlog takes longer than this to drain, 0 disables",
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&DynamicEcnQueueDisc::m_targetDelay),
+                          MakeTimeChecker())
+            .AddAttribute("UpdateInterval", "How often the drain rate, flow count and threshold are updated",
+                          TimeValue(MilliSeconds(1)),
+                          MakeTimeAccessor(&DynamicEcnQueueDisc::m_updateInterval),
+                          MakeTimeChecker())
+            .AddAttribute("Alpha", "EWMA weight of the latest drain rate sample",
+                          DoubleValue(0.25),
+                          MakeDoubleAccessor(&DynamicEcnQueueDisc::m_alpha),
+                          MakeDoubleChecker<double>(0.0, 1.0))
+            .AddAttribute("FlowBits", "Size of the active flow bitmap, a multiple of 64",
+                          UintegerValue(1024),
+                          MakeUintegerAccessor(&DynamicEcnQueueDisc::m_flowBits),
+                          MakeUintegerChecker<uint32_t>(64))
+            .AddTraceSource("Threshold", "The marking threshold in packets",
+                            MakeTraceSourceAccessor(&DynamicEcnQueueDisc::m_threshold),
+                            "ns3::TracedValueCallback::Uint32")
+            .AddTraceSource("Update", "The threshold was recomputed",
+                            MakeTraceSourceAccessor(&DynamicEcnQueueDisc::m_updateTrace),
+                            "ns3::DynamicEcnQueueDisc::UpdateTracedCallback");
+        return tid;
+    }
+
+    // drain rate, estimated active flows, threshold in packets
+    typedef void (*UpdateTracedCallback)(DataRate, double, uint32_t);
+
+    DynamicEcnQueueDisc()
+        : QueueDisc(QueueDiscSizePolicy::SINGLE_INTERNAL_QUEUE){
+    }
+
+    DataRate GetDrainRate() const{
+        return DataRate(static_cast<uint64_t>(m_drainRateBps));
+    }
+
+    double GetActiveFlows() const{
+        return m_activeFlows;
+    }
+
+private:
+    bool DoEnqueue(Ptr<QueueDiscItem> item) override{
+        Time now = Simulator::Now();
+        if(now - m_lastUpdate >= m_updateInterval){
+            Update(now);
+        }
+        uint32_t bit = item->Hash() % m_flowBits;
+        m_flows[bit / 64] |= 1ULL << (bit % 64);
+
+        if(GetCurrentSize() + item > GetMaxSize()){
+            DropBeforeEnqueue(item, LIMIT_EXCEEDED_DROP);
+            return false;
+        }
+        if(GetNPackets() >= m_threshold){
+            if(!m_useEcn || !Mark(item, THRESHOLD_MARK)){
+                DropBeforeEnqueue(item, THRESHOLD_DROP);
+                return false;
+            }
+        }else if(m_targetDelay.IsStrictlyPositive() && GetNBytes() * 8.0 / m_drainRateBps > m_targetDelay.GetSeconds()){
+            if(!m_useEcn || !Mark(item, DELAY_MARK)){
+                DropBeforeEnqueue(item, DELAY_DROP);
+                return false;
+            }
+        }
+        return GetInternalQueue(0)->Enqueue(item);
+    }
+
+    Ptr<QueueDiscItem> DoDequeue() override{
+        Ptr<QueueDiscItem> item = GetInternalQueue(0)->Dequeue();
+        if(!item){
+            m_backlogged = false;
+            return nullptr;
+        }
+        // Only time spent with a backlog counts towards the drain rate, so
+        // idle periods do not read as a slow link
+        Time now = Simulator::Now();
+        if(m_backlogged){
+            m_busy += now - m_lastDequeue;
+            m_drainedBytes += item->GetSize();
+        }
+        m_lastDequeue = now;
+        m_backlogged = GetInternalQueue(0)->GetNPackets() > 0;
+        return item;
+    }
+
+    bool CheckConfig() override{
+        if(GetNQueueDiscClasses() > 0 || GetNPacketFilters() > 0){
+            NS_LOG_UNCOND("DynamicEcnQueueDisc cannot have classes or packet filters");
+            return false;
+        }
+        if(m_minThreshold > m_maxThreshold){
+            NS_LOG_UNCOND("DynamicEcnQueueDisc MinThreshold is above MaxThreshold");
+            return false;
+        }
+        if(GetNInternalQueues() == 0){
+            AddInternalQueue(CreateObjectWithAttributes<DropTailQueue<QueueDiscItem>>("MaxSize", QueueSizeValue(GetMaxSize())));
+        }
+        return GetNInternalQueues() == 1;
+    }
+
+    void InitializeParams() override{
+        m_flowBits = m_flowBits / 64 * 64;
+        m_flows.assign(m_flowBits / 64, 0);
+        m_drainRateBps = m_linkBandwidth.GetBitRate();
+        m_activeFlows = 1;
+        m_lastUpdate = Simulator::Now();
+        m_threshold = Threshold();
+    }
+
+    void Update(Time now){
+        if(m_busy.IsStrictlyPositive() && m_drainedBytes > 0){
+            double sample = m_drainedBytes * 8.0 / m_busy.GetSeconds();
+            m_drainRateBps = (1 - m_alpha) * m_drainRateBps + m_alpha * sample;
+        }
+        m_busy = Seconds(0);
+        m_drainedBytes = 0;
+
+        // Linear counting; an interval without packets keeps the last estimate
+        uint32_t set = 0;
+        for(uint64_t& word : m_flows){
+            set += __builtin_popcountll(word);
+            word = 0;
+        }
+        if(set > 0){
+            uint32_t zeros = std::max<uint32_t>(1, m_flowBits - set);
+            m_activeFlows = std::max(1.0, -static_cast<double>(m_flowBits) * std::log(static_cast<double>(zeros) / m_flowBits));
+        }
+        m_lastUpdate = now;
+        m_threshold = Threshold();
+        m_updateTrace(GetDrainRate(), m_activeFlows, m_threshold);
+    }
+
+    uint32_t Threshold() const{
+        double packets = m_lambda * m_drainRateBps * m_rtt.GetSeconds() / (8.0 * m_meanPktSize) / std::sqrt(m_activeFlows);
+        return std::min<uint32_t>(m_maxThreshold, std::max<uint32_t>(m_minThreshold, static_cast<uint32_t>(std::lround(packets))));
+    }
+
+    bool m_useEcn;
+    DataRate m_linkBandwidth;
+    Time m_rtt;
+    double m_lambda;
+    uint32_t m_meanPktSize;
+    uint32_t m_minThreshold;
+    uint32_t m_maxThreshold;
+    Time m_targetDelay;
+    Time m_updateInterval;
+    double m_alpha;
+    uint32_t m_flowBits;
+
+    std::vector<uint64_t> m_flows;
+    double m_drainRateBps = 0;
+    double m_activeFlows = 1;
+    Time m_busy;
+    uint64_t m_drainedBytes = 0;
+    Time m_lastDequeue;
+    Time m_lastUpdate;
+    bool m_backlogged = false;
+    TracedValue<uint32_t> m_threshold;
+    TracedCallback<DataRate, double, uint32_t> m_updateTrace;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(DynamicEcnQueueDisc);
+
+} // namespace ns3
+
+#endif
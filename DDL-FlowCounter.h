@@ -0,0 +1,116 @@
+#ifndef DDL_FLOW_COUNTER_H
+#define DDL_FLOW_COUNTER_H
+
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/applications-module.h"
+#include "DDL-TraceWriter.h"
+
+using namespace ns3;
+
+// Per-flow receive byte counters for the throughput trace.
+//
+// Each flow is registered once at setup and gets a dense id; its 5-tuple is
+// cached in flat arrays (the source port is filled in from the first received
+// packet, since TCP picks it at connect time). Received bytes come from the
+// sink's Rx trace, or from Count() for receivers that are not PacketSinks.
+// They are added to the flow's interval counter. Every interval each flow that
+// has received data at all gets a row, zero while it is idle, as FlowMonitor's
+// did, so plots of a flow over time stay flat through its off periods. A tick
+// is one pass over the flat arrays and nothing is allocated after setup.
+//
+// Unlike FlowMonitor this only sees data that reaches a sink, so reverse
+// (ACK) flows do not appear in the trace.
+
+class FlowRxCounter {
+public:
+    void Reserve(uint32_t flows){
+        m_src.reserve(flows);
+        m_dst.reserve(flows);
+        m_srcPort.reserve(flows);
+        m_dstPort.reserve(flows);
+        m_bytes.reserve(flows);
+        m_totalBytes.reserve(flows);
+    }
+
+    // Registers a flow whose received bytes are reported through Count().
+    uint32_t Add(Ipv4Address source, Ipv4Address dst, uint16_t dstPort){
+        uint32_t id = m_src.size();
+        m_src.push_back(source.Get());
+        m_dst.push_back(dst.Get());
+        m_srcPort.push_back(0);
+        m_dstPort.push_back(dstPort);
+        m_bytes.push_back(0);
+        m_totalBytes.push_back(0);
+        return id;
+    }
+
+    // Registers the flow from source to the sink listening on dst:dstPort.
+    uint32_t Track(Ptr<Application> sink, Ipv4Address source, Ipv4Address dst, uint16_t dstPort){
+        uint32_t id = Add(source, dst, dstPort);
+        sink->TraceConnectWithoutContext("Rx", Callback<void, Ptr<const Packet>, const Address&>([this, id](Ptr<const Packet> packet, const Address& from){
+            Count(id, packet->GetSize(), from);
+        }));
+        return id;
+    }
+
+    void Count(uint32_t id, uint32_t bytes, const Address& from){
+        if(m_srcPort[id] == 0 && InetSocketAddress::IsMatchingType(from)){
+            m_srcPort[id] = InetSocketAddress::ConvertFrom(from).GetPort();
+        }
+        m_bytes[id] += bytes;
+        m_totalBytes[id] += bytes;
+    }
+
+    void Start(Time interval, TraceWriter* out){
+        m_interval = interval;
+        m_out = out;
+        Simulator::Schedule(m_interval, &FlowRxCounter::Tick, this);
+    }
+
+    uint64_t GetTotalBytes(uint32_t id) const{
+        return m_totalBytes[id];
+    }
+
+    uint32_t GetNFlows() const{
+        return m_src.size();
+    }
+
+    uint64_t GetTicks() const{
+        return m_ticks;
+    }
+
+private:
+    void Tick(){
+        m_ticks++;
+        int64_t now = Simulator::Now().GetMilliSeconds();
+        double scale = 8.0 / m_interval.GetSeconds() / 1e6;
+        // Flows that never received anything have no source port yet
+        for(uint32_t id = 0; id < m_src.size(); id++){
+            if(m_totalBytes[id] == 0){
+                continue;
+            }
+            Write(now, id, m_bytes[id] * scale);
+            m_bytes[id] = 0;
+        }
+        Simulator::Schedule(m_interval, &FlowRxCounter::Tick, this);
+    }
+
+    void Write(int64_t now, uint32_t id, double mbps){
+        m_out->Append(now, m_src[id], m_srcPort[id], m_dst[id], m_dstPort[id], mbps);
+    }
+
+    std::vector<uint32_t> m_src;
+    std::vector<uint32_t> m_dst;
+    std::vector<uint16_t> m_srcPort;
+    std::vector<uint16_t> m_dstPort;
+    std::vector<uint64_t> m_bytes;
+    std::vector<uint64_t> m_totalBytes;
+    Time m_interval;
+    TraceWriter* m_out = nullptr;
+    uint64_t m_ticks = 0;
+};
+
+#endif
@@ -0,0 +1,409 @@
+#ifndef DDL_FLOW_PROBE_H
+#define DDL_FLOW_PROBE_H
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "DDL-TraceWriter.h"
+#include "DDL-Distributed.h"
+
+using namespace ns3;
+
+// Selective per-flow statistics on chosen end hosts.
+//
+// FlowMonitor probes every node and classifies every packet at every hop.
+// HostFlowProbe hooks only the Ipv4L3Protocol SendOutgoing and LocalDeliver
+// traces of the hosts it is installed on, so the per-packet cost is one
+// classification at the sender and one tag lookup at the receiver no matter
+// how many switch tiers the packet crosses. Only the requested metrics are
+// kept:
+//   rx     tx/rx packets and bytes per flow
+//   delay  one-way delay mean and percentiles from a log-scale histogram
+//   loss   packets sent but not received by the end of the run
+// Flows live in a preallocated open-addressing table of MaxFlows entries
+// keyed by the 5-tuple, with the delay histograms allocated alongside; flows
+// beyond that are only counted as overflow.
+// Packets leaving a probed host carry a small tag with the flow id and the
+// send time, so the receiver needs no lookup; packets from unprobed senders
+// are classified at the receiver and have no delay. Under MPI every rank
+// keeps its own table for its own hosts; a packet from another rank's host is
+// classified again at the receiver (the delay from its tag still counts).
+// At the end rank 0 gathers the tables and merges the two halves of flows
+// whose ends are on different ranks by 5-tuple, so each flow is one row.
+
+namespace ns3 {
+
+class FlowProbeTag : public Tag {
+public:
+    static TypeId GetTypeId(){
+        static TypeId tid = TypeId("ns3::FlowProbeTag")
+            .SetParent<Tag>()
+            .SetGroupName("Applications")
+            .AddConstructor<FlowProbeTag>();
+        return tid;
+    }
+
+    TypeId GetInstanceTypeId() const override{
+        return GetTypeId();
+    }
+
+    uint32_t GetSerializedSize() const override{
+        return 16;
+    }
+
+    void Serialize(TagBuffer buffer) const override{
+        buffer.WriteU32(flow);
+        buffer.WriteU32(rank);
+        buffer.WriteU64(sent);
+    }
+
+    void Deserialize(TagBuffer buffer) override{
+        flow = buffer.ReadU32();
+        rank = buffer.ReadU32();
+        sent = buffer.ReadU64();
+    }
+
+    void Print(std::ostream& os) const override{
+        os << "flow=" << flow << " rank=" << rank << " sent=" << sent;
+    }
+
+    uint32_t flow = 0;
+    uint32_t rank = 0;     // flow ids are per rank
+    uint64_t sent = 0;     // ns
+};
+
+NS_OBJECT_ENSURE_REGISTERED(FlowProbeTag);
+
+} // namespace ns3
+
+class HostFlowProbe {
+public:
+    enum Metric : uint32_t { RX = 1, DELAY = 2, LOSS = 4 };
+
+    // 4 bins per power of two of the delay in us, up to ~4 s
+    static constexpr uint32_t kDelayBins = 88;
+
+    // metrics: comma separated list of rx, delay, loss
+    void Configure(const std::string& metrics, uint32_t maxFlows){
+        m_metrics = 0;
+        std::string rest = metrics;
+        while(!rest.empty()){
+            size_t comma = rest.find(',');
+            std::string name = rest.substr(0, comma);
+            rest = comma == std::string::npos ? "" : rest.substr(comma + 1);
+            if(name == "rx"){
+                m_metrics |= RX;
+            }else if(name == "delay"){
+                m_metrics |= DELAY;
+            }else if(name == "loss"){
+                m_metrics |= LOSS;
+            }else if(!name.empty()){
+                NS_FATAL_ERROR("Unknown flow probe metric " << name << " (rx, delay or loss)");
+            }
+        }
+        uint32_t capacity = 1;
+        while(capacity < 2 * maxFlows){
+            capacity <<= 1;
+        }
+        m_maxFlows = maxFlows;
+        m_slots.assign(capacity, kEmpty);
+        m_flows.reserve(maxFlows);
+        if(m_metrics & DELAY){
+            m_delayBins.assign(maxFlows * kDelayBins, 0);
+        }
+    }
+
+    bool IsEnabled() const{
+        return m_metrics != 0;
+    }
+
+    void Install(Ptr<Node> node){
+        if(!IsLocal(node)){
+            return;
+        }
+        Ptr<Ipv4L3Protocol> ipv4 = node->GetObject<Ipv4L3Protocol>();
+        ipv4->TraceConnectWithoutContext("SendOutgoing", Callback<void, const Ipv4Header&, Ptr<const Packet>, uint32_t>([this](const Ipv4Header& header, Ptr<const Packet> packet, uint32_t){
+            Sent(header, packet);
+        }));
+        ipv4->TraceConnectWithoutContext("LocalDeliver", Callback<void, const Ipv4Header&, Ptr<const Packet>, uint32_t>([this](const Ipv4Header& header, Ptr<const Packet> packet, uint32_t){
+            Received(header, packet);
+        }));
+    }
+
+    uint64_t GetPackets() const{
+        return m_packets;
+    }
+
+    // Collective under MPI: every rank calls it, rank 0 writes the file.
+    void Write(const std::string& path, bool binary){
+        Gather();
+        if(LocalRank() != 0){
+            return;
+        }
+        std::vector<TraceWriter::Column> columns = {{"FlowId", TraceWriter::U32}, {"Source IP", TraceWriter::IPV4}, {"Source Port", TraceWriter::U32}, {"Dest IP", TraceWriter::IPV4}, {"Dest Port", TraceWriter::U32}, {"Protocol", TraceWriter::U32}};
+        if(m_metrics & (RX | LOSS)){
+            columns.insert(columns.end(), {{"TxPackets", TraceWriter::U64}, {"TxBytes", TraceWriter::U64}, {"RxPackets", TraceWriter::U64}, {"RxBytes", TraceWriter::U64}});
+        }
+        if(m_metrics & DELAY){
+            columns.insert(columns.end(), {{"MeanDelay(us)", TraceWriter::F64}, {"P50Delay(us)", TraceWriter::F64}, {"P99Delay(us)", TraceWriter::F64}, {"MaxDelay(us)", TraceWriter::F64}});
+        }
+        if(m_metrics & LOSS){
+            columns.push_back({"Lost", TraceWriter::U64});
+        }
+        TraceWriter out;
+        out.Open(path, columns, binary, 4096);
+        for(uint32_t id = 0; id < m_flows.size(); id++){
+            const Flow& f = m_flows[id];
+            double values[15];
+            uint32_t n = 0;
+            values[n++] = id;
+            values[n++] = f.src;
+            values[n++] = f.ports >> 16;
+            values[n++] = f.dst;
+            values[n++] = f.ports & 0xffff;
+            values[n++] = f.protocol;
+            if(m_metrics & (RX | LOSS)){
+                values[n++] = f.txPackets;
+                values[n++] = f.txBytes;
+                values[n++] = f.rxPackets;
+                values[n++] = f.rxBytes;
+            }
+            if(m_metrics & DELAY){
+                values[n++] = f.delayed > 0 ? f.delaySum / f.delayed / 1e3 : 0;
+                values[n++] = DelayPercentile(id, 0.5);
+                values[n++] = DelayPercentile(id, 0.99);
+                values[n++] = f.delayMax / 1e3;
+            }
+            if(m_metrics & LOSS){
+                values[n++] = f.txPackets > f.rxPackets ? f.txPackets - f.rxPackets : 0;
+            }
+            out.AppendRow(values, n);
+        }
+        out.Close();
+        if(m_overflow > 0){
+            std::cout << "Flow probe: " << m_overflow << " packets of flows beyond MaxFlows=" << m_maxFlows << " not recorded" << std::endl;
+        }
+    }
+
+private:
+    static constexpr uint32_t kEmpty = 0xffffffff;
+
+    struct Flow {
+        uint32_t src;
+        uint32_t dst;
+        uint32_t ports;      // source port << 16 | destination port
+        uint8_t protocol;
+        uint64_t txPackets = 0;
+        uint64_t txBytes = 0;
+        uint64_t rxPackets = 0;
+        uint64_t rxBytes = 0;
+        uint64_t delayed = 0;
+        double delaySum = 0;        // ns
+        uint64_t delayMax = 0;      // ns
+    };
+
+    static uint32_t Ports(const Ipv4Header& header, Ptr<const Packet> packet){
+        uint8_t protocol = header.GetProtocol();
+        if((protocol != 6 && protocol != 17) || packet->GetSize() < 4){
+            return 0;
+        }
+        uint8_t buffer[4];
+        packet->CopyData(buffer, 4);
+        return (buffer[0] << 24) | (buffer[1] << 16) | (buffer[2] << 8) | buffer[3];
+    }
+
+    // Dense id of the flow, kEmpty when the table is full.
+    uint32_t Classify(const Ipv4Header& header, Ptr<const Packet> packet){
+        uint32_t src = header.GetSource().Get();
+        uint32_t dst = header.GetDestination().Get();
+        uint32_t ports = Ports(header, packet);
+        uint8_t protocol = header.GetProtocol();
+        uint64_t h = (static_cast<uint64_t>(src) << 32 | dst) * 0x9e3779b97f4a7c15ULL ^ (static_cast<uint64_t>(ports) << 8 | protocol) * 0xc2b2ae3d27d4eb4fULL;
+        uint32_t mask = m_slots.size() - 1;
+        for(uint32_t slot = (h ^ (h >> 29)) & mask; ; slot = (slot + 1) & mask){
+            uint32_t id = m_slots[slot];
+            if(id == kEmpty){
+                if(m_flows.size() == m_maxFlows){
+                    return kEmpty;
+                }
+                m_slots[slot] = m_flows.size();
+                Flow flow;
+                flow.src = src;
+                flow.dst = dst;
+                flow.ports = ports;
+                flow.protocol = protocol;
+                m_flows.push_back(flow);
+                return m_slots[slot];
+            }
+            const Flow& f = m_flows[id];
+            if(f.src == src && f.dst == dst && f.ports == ports && f.protocol == protocol){
+                return id;
+            }
+        }
+    }
+
+    void Sent(const Ipv4Header& header, Ptr<const Packet> packet){
+        m_packets++;
+        uint32_t id = Classify(header, packet);
+        if(id == kEmpty){
+            m_overflow++;
+            return;
+        }
+        Flow& f = m_flows[id];
+        f.txPackets++;
+        f.txBytes += packet->GetSize() + header.GetSerializedSize();
+        FlowProbeTag tag;
+        tag.flow = id;
+        tag.rank = LocalRank();
+        tag.sent = Simulator::Now().GetNanoSeconds();
+        // Same approach as FlowMonitor's Ipv4FlowProbe: tag the outgoing packet in place
+        ConstCast<Packet>(packet)->AddPacketTag(tag);
+    }
+
+    void Received(const Ipv4Header& header, Ptr<const Packet> packet){
+        m_packets++;
+        FlowProbeTag tag;
+        bool tagged = packet->PeekPacketTag(tag);
+        uint32_t id = tagged && tag.rank == LocalRank() ? tag.flow : Classify(header, packet);
+        if(id == kEmpty){
+            m_overflow++;
+            return;
+        }
+        Flow& f = m_flows[id];
+        f.rxPackets++;
+        f.rxBytes += packet->GetSize() + header.GetSerializedSize();
+        if(tagged && (m_metrics & DELAY)){
+            uint64_t delay = Simulator::Now().GetNanoSeconds() - tag.sent;
+            f.delayed++;
+            f.delaySum += delay;
+            f.delayMax = std::max(f.delayMax, delay);
+            m_delayBins[id * kDelayBins + DelayBin(delay / 1000)]++;
+        }
+    }
+
+    // Rank 0 replaces its table with the flows of all ranks, summing the
+    // counters and histograms of the same 5-tuple and renumbering the ids.
+    void Gather(){
+#ifdef NS3_MPI
+        if(RankCount() == 1){
+            return;
+        }
+        std::vector<Flow> flows = GatherToRoot(m_flows);
+        std::vector<uint32_t> bins = GatherToRoot(m_delayBins);
+        std::vector<uint32_t> flowsPerRank = GatherToRoot(std::vector<uint32_t>{static_cast<uint32_t>(m_flows.size())});
+        if(LocalRank() != 0){
+            return;
+        }
+        uint32_t binsPerRank = (m_metrics & DELAY) ? m_maxFlows * kDelayBins : 0;
+        std::map<std::tuple<uint32_t, uint32_t, uint32_t, uint8_t>, uint32_t> ids;
+        m_flows.clear();
+        m_delayBins.clear();
+        size_t first = 0;
+        for(uint32_t rank = 0; rank < flowsPerRank.size(); rank++){
+            for(uint32_t i = 0; i < flowsPerRank[rank]; i++){
+                const Flow& f = flows[first + i];
+                auto key = std::make_tuple(f.src, f.dst, f.ports, f.protocol);
+                auto it = ids.find(key);
+                if(it == ids.end()){
+                    it = ids.emplace(key, m_flows.size()).first;
+                    Flow merged;
+                    merged.src = f.src;
+                    merged.dst = f.dst;
+                    merged.ports = f.ports;
+                    merged.protocol = f.protocol;
+                    m_flows.push_back(merged);
+                    m_delayBins.resize(m_delayBins.size() + (binsPerRank > 0 ? kDelayBins : 0), 0);
+                }
+                Flow& m = m_flows[it->second];
+                m.txPackets += f.txPackets;
+                m.txBytes += f.txBytes;
+                m.rxPackets += f.rxPackets;
+                m.rxBytes += f.rxBytes;
+                m.delayed += f.delayed;
+                m.delaySum += f.delaySum;
+                m.delayMax = std::max(m.delayMax, f.delayMax);
+                for(uint32_t b = 0; binsPerRank > 0 && b < kDelayBins; b++){
+                    m_delayBins[it->second * kDelayBins + b] += bins[rank * binsPerRank + i * kDelayBins + b];
+                }
+            }
+            first += flowsPerRank[rank];
+        }
+#endif
+    }
+
+#ifdef NS3_MPI
+    // Concatenation of every rank's vector on rank 0, empty elsewhere.
+    template <typename T>
+    static std::vector<T> GatherToRoot(const std::vector<T>& local){
+        MPI_Comm comm = MpiInterface::GetCommunicator();
+        int bytes = local.size() * sizeof(T);
+        std::vector<int> counts(RankCount());
+        std::vector<int> offsets(RankCount());
+        MPI_Gather(&bytes, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, comm);
+        int total = 0;
+        for(uint32_t rank = 0; rank < counts.size(); rank++){
+            offsets[rank] = total;
+            total += counts[rank];
+        }
+        std::vector<T> all(LocalRank() == 0 ? total / sizeof(T) : 0);
+        MPI_Gatherv(local.data(), bytes, MPI_BYTE, all.data(), counts.data(), offsets.data(), MPI_BYTE, 0, comm);
+        return all;
+    }
+#endif
+
+    // 4 bins per octave: [2^e, 2^e * 1.25), [2^e * 1.25, 2^e * 1.5), ...
+    static uint32_t DelayBin(uint64_t us){
+        if(us < 4){
+            return us;
+        }
+        uint32_t e = 63 - __builtin_clzll(us);
+        uint32_t bin = 4 * (e - 1) + ((us >> (e - 2)) & 3);
+        return std::min(bin, kDelayBins - 1);
+    }
+
+    static double DelayBinLow(uint32_t bin){
+        if(bin < 4){
+            return bin;
+        }
+        uint32_t e = bin / 4 + 1;
+        return std::ldexp(1.0 + (bin % 4) / 4.0, e);
+    }
+
+    double DelayPercentile(uint32_t id, double q) const{
+        const uint32_t* bins = &m_delayBins[id * kDelayBins];
+        uint64_t total = 0;
+        for(uint32_t b = 0; b < kDelayBins; b++){
+            total += bins[b];
+        }
+        if(total == 0){
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(std::ceil(q * total));
+        uint64_t seen = 0;
+        for(uint32_t b = 0; b < kDelayBins; b++){
+            seen += bins[b];
+            if(seen >= rank){
+                // Midpoint of the bin
+                return (DelayBinLow(b) + DelayBinLow(b + 1)) / 2;
+            }
+        }
+        return DelayBinLow(kDelayBins - 1);
+    }
+
+    uint32_t m_metrics = 0;
+    uint32_t m_maxFlows = 0;
+    std::vector<uint32_t> m_slots;
+    std::vector<Flow> m_flows;
+    std::vector<uint32_t> m_delayBins;
+    uint64_t m_packets = 0;
+    uint64_t m_overflow = 0;
+};
+
+#endif
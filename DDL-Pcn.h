@@ -0,0 +1,332 @@
+#ifndef DDL_PCN_H
+#define DDL_PCN_H
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/traffic-control-module.h"
+
+// Proactive Congestion Notification (PCN).
+//
+// PcnQueueDisc is a FIFO queue disc that learns the iteration phase of the
+// registered senders (the workers) from their packet arrivals: a gap longer
+// than IdleGap starts a new burst, the spacing of burst starts gives the
+// iteration period and each burst's bytes over its duration give its rate.
+// Lead before the next predicted burst it checks which senders will start
+// within Window of each other; if their combined rate exceeds the link, it
+// notifies each of them, after NotificationDelay, of a rate that fits their
+// share of TargetUtilization * LinkBandwidth until the predicted end of the
+// burst. A notified sender is expected to keep its bytes and send them over a
+// longer time (training workers queue their gradients; on/off workers get a
+// longer on time), so the burst ends when the bytes it offers at its nominal
+// rate, or at its measured rate if it has none, have gone out at the allowed
+// rate. Senders that have not shown a stable period yet are left alone, so
+// the disc degrades to drop-tail (optionally with DCTCP style marking above
+// MarkThreshold) for background traffic and the first iterations.
+//
+// PcnRateController sits on the worker and applies the notified rate through
+// a callback (e.g. setting the OnOffApplication DataRate), restoring the
+// nominal rate once the notification expires. A nominal rate of 0 means the
+// sender is not paced at all.
+
+namespace ns3 {
+
+class PcnRateController : public Object {
+public:
+    static TypeId GetTypeId(){
+        static TypeId tid = TypeId("ns3::PcnRateController")
+            .SetParent<Object>()
+            .SetGroupName("Applications")
+            .AddConstructor<PcnRateController>()
+            .AddAttribute("NominalRate", "Rate the sender uses when not notified",
+                          DataRateValue(DataRate("900Mbps")),
+                          MakeDataRateAccessor(&PcnRateController::m_nominal),
+                          MakeDataRateChecker())
+            .AddTraceSource("RateChange", "The sending rate changed",
+                            MakeTraceSourceAccessor(&PcnRateController::m_rateTrace),
+                            "ns3::DataRate::TracedCallback");
+        return tid;
+    }
+
+    void SetRateCallback(Callback<void, DataRate> apply){
+        m_apply = apply;
+    }
+
+    DataRate GetNominalRate() const{
+        return m_nominal;
+    }
+
+    // Limits the sender to rate until the given absolute time. Overlapping
+    // notifications from several queues keep the lowest rate.
+    void Notify(DataRate rate, Time until){
+        Time now = Simulator::Now();
+        if(now < m_until){
+            m_allowed = std::min(m_allowed, rate);
+            m_until = std::max(m_until, until);
+        }else{
+            m_allowed = rate;
+            m_until = until;
+        }
+        Apply(m_allowed);
+        m_restore.Cancel();
+        m_restore = Simulator::Schedule(m_until - now, &PcnRateController::Apply, this, m_nominal);
+    }
+
+protected:
+    void DoDispose() override{
+        m_restore.Cancel();
+        m_apply = MakeNullCallback<void, DataRate>();
+        Object::DoDispose();
+    }
+
+private:
+    void Apply(DataRate rate){
+        if(!m_apply.IsNull()){
+            m_apply(rate);
+        }
+        m_rateTrace(rate);
+    }
+
+    DataRate m_nominal;
+    DataRate m_allowed;
+    Time m_until;
+    EventId m_restore;
+    Callback<void, DataRate> m_apply;
+    TracedCallback<DataRate> m_rateTrace;
+};
+
+class PcnQueueDisc : public QueueDisc {
+public:
+    static constexpr const char* LIMIT_EXCEEDED_DROP = "Queue disc limit exceeded";
+    static constexpr const char* THRESHOLD_MARK = "Above marking threshold";
+
+    static TypeId GetTypeId(){
+        static TypeId tid = TypeId("ns3::PcnQueueDisc")
+            .SetParent<QueueDisc>()
+            .SetGroupName("TrafficControl")
+            .AddConstructor<PcnQueueDisc>()
+            .AddAttribute("MaxSize", "The max queue size",
+                          QueueSizeValue(QueueSize("100p")),
+                          MakeQueueSizeAccessor(&QueueDisc::SetMaxSize, &QueueDisc::GetMaxSize),
+                          MakeQueueSizeChecker())
+            .AddAttribute("LinkBandwidth", "Capacity of the link this queue disc feeds",
+                          DataRateValue(DataRate("1Gbps")),
+                          MakeDataRateAccessor(&PcnQueueDisc::m_linkBandwidth),
+                          MakeDataRateChecker())
+            .AddAttribute("TargetUtilization", "Share of the link the notified senders may use together",
+                          DoubleValue(0.95),
+                          MakeDoubleAccessor(&PcnQueueDisc::m_targetUtilization),
+                          MakeDoubleChecker<double>(0.0, 1.0))
+            .AddAttribute("IdleGap", "Silence after which a sender's next packet starts a new burst",
+                          TimeValue(MilliSeconds(100)),
+                          MakeTimeAccessor(&PcnQueueDisc::m_idleGap),
+                          MakeTimeChecker())
+            .AddAttribute("Lead", "How long before a predicted burst the senders are notified",
+                          TimeValue(MilliSeconds(10)),
+                          MakeTimeAccessor(&PcnQueueDisc::m_lead),
+                          MakeTimeChecker())
+            .AddAttribute("Window", "Bursts predicted to start this close together overlap",
+                          TimeValue(MilliSeconds(20)),
+                          MakeTimeAccessor(&PcnQueueDisc::m_window),
+                          MakeTimeChecker())
+            .AddAttribute("NotificationDelay", "Time for a notification to reach the sender",
+                          TimeValue(MicroSeconds(600)),
+                          MakeTimeAccessor(&PcnQueueDisc::m_notificationDelay),
+                          MakeTimeChecker())
+            .AddAttribute("MinPeriods", "Burst periods to observe before predicting",
+                          UintegerValue(2),
+                          MakeUintegerAccessor(&PcnQueueDisc::m_minPeriods),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("Tolerance", "Largest relative deviation of the last period from the average for a sender to count as periodic",
+                          DoubleValue(0.1),
+                          MakeDoubleAccessor(&PcnQueueDisc::m_tolerance),
+                          MakeDoubleChecker<double>(0.0))
+            .AddAttribute("Alpha", "EWMA weight of the latest burst in the period and rate estimates",
+                          DoubleValue(0.25),
+                          MakeDoubleAccessor(&PcnQueueDisc::m_alpha),
+                          MakeDoubleChecker<double>(0.0, 1.0))
+            .AddAttribute("MarkThreshold", "ECN mark above this many packets, 0 disables marking",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&PcnQueueDisc::m_markThreshold),
+                          MakeUintegerChecker<uint32_t>())
+            .AddTraceSource("Notify", "A sender was notified of a predicted burst",
+                            MakeTraceSourceAccessor(&PcnQueueDisc::m_notifyTrace),
+                            "ns3::PcnQueueDisc::NotifyTracedCallback");
+        return tid;
+    }
+
+    // source, allowed rate, predicted burst start, notification expiry
+    typedef void (*NotifyTracedCallback)(Ipv4Address, DataRate, Time, Time);
+
+    PcnQueueDisc()
+        : QueueDisc(QueueDiscSizePolicy::SINGLE_INTERNAL_QUEUE){
+    }
+
+    void AddSender(Ipv4Address source, Ptr<PcnRateController> controller){
+        m_senders[source].controller = controller;
+    }
+
+protected:
+    void DoDispose() override{
+        for(auto& entry : m_senders){
+            entry.second.predict.Cancel();
+            entry.second.controller = nullptr;
+        }
+        m_senders.clear();
+        QueueDisc::DoDispose();
+    }
+
+private:
+    struct Sender {
+        Ptr<PcnRateController> controller;
+        Time burstStart = Seconds(-1);
+        Time lastArrival;
+        Time period;
+        Time lastInterval;
+        Time duration;
+        double rateBps = 0;
+        uint64_t burstBytes = 0;
+        uint32_t periods = 0;
+        Time notifiedFor = Seconds(-1);
+        EventId predict;
+    };
+
+    bool DoEnqueue(Ptr<QueueDiscItem> item) override{
+        if(GetCurrentSize() + item > GetMaxSize()){
+            DropBeforeEnqueue(item, LIMIT_EXCEEDED_DROP);
+            return false;
+        }
+        if(m_markThreshold > 0 && GetNPackets() >= m_markThreshold){
+            Mark(item, THRESHOLD_MARK);
+        }
+        Ptr<Ipv4QueueDiscItem> ipItem = DynamicCast<Ipv4QueueDiscItem>(item);
+        if(ipItem){
+            auto it = m_senders.find(ipItem->GetHeader().GetSource());
+            if(it != m_senders.end()){
+                Observe(it->second, item->GetSize());
+            }
+        }
+        return GetInternalQueue(0)->Enqueue(item);
+    }
+
+    Ptr<QueueDiscItem> DoDequeue() override{
+        return GetInternalQueue(0)->Dequeue();
+    }
+
+    bool CheckConfig() override{
+        if(GetNQueueDiscClasses() > 0 || GetNPacketFilters() > 0){
+            NS_LOG_UNCOND("PcnQueueDisc cannot have classes or packet filters");
+            return false;
+        }
+        if(GetNInternalQueues() == 0){
+            AddInternalQueue(CreateObjectWithAttributes<DropTailQueue<QueueDiscItem>>("MaxSize", QueueSizeValue(GetMaxSize())));
+        }
+        return GetNInternalQueues() == 1;
+    }
+
+    void InitializeParams() override{
+    }
+
+    void Observe(Sender& sender, uint32_t bytes){
+        Time now = Simulator::Now();
+        if(sender.burstStart.IsNegative() || now - sender.lastArrival > m_idleGap){
+            if(!sender.burstStart.IsNegative()){
+                // Close the previous burst and fold it into the estimates
+                Time interval = now - sender.burstStart;
+                Time duration = sender.lastArrival - sender.burstStart;
+                double rate = duration.IsStrictlyPositive() ? sender.burstBytes * 8.0 / duration.GetSeconds() : 0;
+                if(sender.periods == 0){
+                    sender.period = interval;
+                    sender.duration = duration;
+                    sender.rateBps = rate;
+                }else{
+                    sender.period = Seconds((1 - m_alpha) * sender.period.GetSeconds() + m_alpha * interval.GetSeconds());
+                    sender.duration = Seconds((1 - m_alpha) * sender.duration.GetSeconds() + m_alpha * duration.GetSeconds());
+                    sender.rateBps = (1 - m_alpha) * sender.rateBps + m_alpha * rate;
+                }
+                sender.lastInterval = interval;
+                sender.periods++;
+            }
+            sender.burstStart = now;
+            sender.burstBytes = 0;
+            if(IsPeriodic(sender)){
+                Time check = sender.period - m_lead;
+                sender.predict.Cancel();
+                if(check.IsStrictlyPositive()){
+                    sender.predict = Simulator::Schedule(check, &PcnQueueDisc::Predict, this);
+                }
+            }
+        }
+        sender.burstBytes += bytes;
+        sender.lastArrival = now;
+    }
+
+    bool IsPeriodic(const Sender& sender) const{
+        if(sender.periods < m_minPeriods || !sender.period.IsStrictlyPositive()){
+            return false;
+        }
+        double deviation = std::abs(sender.lastInterval.GetSeconds() - sender.period.GetSeconds()) / sender.period.GetSeconds();
+        return deviation <= m_tolerance;
+    }
+
+    // Runs Lead ahead of some sender's next burst: collects every periodic
+    // sender predicted to start within Window of now + Lead and notifies them
+    // if together they would overrun the link.
+    void Predict(){
+        Time now = Simulator::Now();
+        Time horizon = now + m_lead + m_window;
+        std::vector<std::map<Ipv4Address, Sender>::iterator> burst;
+        double demand = 0;
+        for(auto it = m_senders.begin(); it != m_senders.end(); it++){
+            const Sender& sender = it->second;
+            if(!IsPeriodic(sender) || sender.rateBps <= 0){
+                continue;
+            }
+            Time next = sender.burstStart + sender.period;
+            if(next >= now && next <= horizon && sender.notifiedFor != next){
+                burst.push_back(it);
+                demand += sender.rateBps;
+            }
+        }
+        double capacity = m_targetUtilization * m_linkBandwidth.GetBitRate();
+        if(burst.size() < 2 || demand <= capacity){
+            return;
+        }
+        for(const auto& it : burst){
+            Sender& sender = it->second;
+            Time next = sender.burstStart + sender.period;
+            sender.notifiedFor = next;
+            DataRate allowed(std::max<uint64_t>(1, sender.rateBps * capacity / demand));
+            // The burst keeps its bytes and lasts as much longer as it is slowed
+            // down; an on/off sender offers its nominal rate for the on time
+            double stretch = std::max(demand / capacity, static_cast<double>(sender.controller->GetNominalRate().GetBitRate()) / allowed.GetBitRate());
+            Time until = next + Seconds(sender.duration.GetSeconds() * stretch) + m_window;
+            m_notifyTrace(it->first, allowed, next, until);
+            Simulator::Schedule(m_notificationDelay, &PcnRateController::Notify, sender.controller, allowed, until);
+        }
+    }
+
+    std::map<Ipv4Address, Sender> m_senders;
+    DataRate m_linkBandwidth;
+    double m_targetUtilization;
+    Time m_idleGap;
+    Time m_lead;
+    Time m_window;
+    Time m_notificationDelay;
+    uint32_t m_minPeriods;
+    double m_tolerance;
+    double m_alpha;
+    uint32_t m_markThreshold;
+    TracedCallback<Ipv4Address, DataRate, Time, Time> m_notifyTrace;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(PcnRateController);
+NS_OBJECT_ENSURE_REGISTERED(PcnQueueDisc);
+
+} // namespace ns3
+
+#endif
@@ -0,0 +1,189 @@
+#ifndef DDL_PROFILER_H
+#define DDL_PROFILER_H
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include "ns3/core-module.h"
+
+using namespace ns3;
+
+// Simulation performance instrumentation.
+//
+// SimProfiler samples the simulator every Interval of simulated time: events
+// executed so far (Simulator::GetEventCount()), wall-clock time since
+// Simulator::Run() started and peak RSS. From consecutive samples it derives
+// events per wall-second and the simulated-time/wall-time ratio, and with
+// print enabled writes a progress line per sample. Named event counters are
+// incremented by the program's own hooks (OnOff sends, queue and throughput
+// log ticks), so what remains of the event count is TCP, devices and
+// channels. Plain counters record callbacks that run inside other events,
+// such as queue transitions. Write() stores everything, plus whatever the
+// program adds with SetInfo()/SetValue() (e.g. topology setup time), as JSON
+// next to the traces.
+
+// Peak resident set size of the process in KB.
+inline long PeakRssKb(){
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+class SimProfiler {
+public:
+    void SetInfo(const std::string& key, const std::string& value){
+        m_info[key] = value;
+    }
+
+    void SetValue(const std::string& key, double value){
+        m_values[key] = value;
+    }
+
+    // Counts scheduler events of one kind (e.g. OnOff sends, log ticks);
+    // the rest of the event count is reported as "other". References stay
+    // valid, so hooks can keep them.
+    uint64_t& EventCounter(const std::string& name){
+        return m_eventCounters[name];
+    }
+
+    // Counts callbacks that run inside other events (e.g. queue transitions).
+    uint64_t& Counter(const std::string& name){
+        return m_counters[name];
+    }
+
+    // Call right before Simulator::Run().
+    void Start(Time interval, bool print){
+        m_interval = interval;
+        m_print = print;
+        m_runStart = std::chrono::steady_clock::now();
+        m_startEvents = Simulator::GetEventCount();
+        m_last = {Simulator::Now().GetSeconds(), 0, m_startEvents, PeakRssKb()};
+        if(!m_interval.IsZero()){
+            Simulator::Schedule(m_interval, &SimProfiler::TakeSample, this);
+        }
+    }
+
+    // Call right after Simulator::Run() returns.
+    void Stop(){
+        m_runSeconds = Wall();
+        m_events = Simulator::GetEventCount() - m_startEvents;
+        m_simSeconds = Simulator::Now().GetSeconds();
+    }
+
+    uint64_t GetEvents() const{
+        return m_events;
+    }
+
+    double GetRunSeconds() const{
+        return m_runSeconds;
+    }
+
+    void Write(const std::string& path){
+        uint64_t ours = m_samples.size();
+        for(const auto& counter : m_eventCounters){
+            ours += counter.second;
+        }
+        std::ofstream out(path);
+        out << std::setprecision(10);
+        out << "{\n";
+        for(const auto& info : m_info){
+            out << "  \"" << info.first << "\": \"" << Escape(info.second) << "\",\n";
+        }
+        for(const auto& value : m_values){
+            out << "  \"" << value.first << "\": " << value.second << ",\n";
+        }
+        out << "  \"sim_seconds\": " << m_simSeconds << ",\n";
+        out << "  \"run_wall_seconds\": " << m_runSeconds << ",\n";
+        out << "  \"events\": " << m_events << ",\n";
+        out << "  \"events_per_wall_second\": " << (m_runSeconds > 0 ? m_events / m_runSeconds : 0) << ",\n";
+        out << "  \"sim_per_wall\": " << (m_runSeconds > 0 ? m_simSeconds / m_runSeconds : 0) << ",\n";
+        out << "  \"peak_rss_kb\": " << PeakRssKb() << ",\n";
+        out << "  \"events_by_type\": {";
+        for(const auto& counter : m_eventCounters){
+            out << "\"" << counter.first << "\": " << counter.second << ", ";
+        }
+        out << "\"profiler_samples\": " << m_samples.size() << ", \"other\": " << (m_events > ours ? m_events - ours : 0) << "},\n";
+        out << "  \"callbacks\": {";
+        for(auto it = m_counters.begin(); it != m_counters.end(); it++){
+            out << (it == m_counters.begin() ? "" : ", ") << "\"" << it->first << "\": " << it->second;
+        }
+        out << "},\n";
+        out << "  \"samples\": [";
+        for(size_t i = 0; i < m_samples.size(); i++){
+            const Sample& s = m_samples[i];
+            out << (i ? ",\n    " : "\n    ") << "{\"sim_seconds\": " << s.sim << ", \"wall_seconds\": " << s.wall
+                << ", \"events\": " << s.events << ", \"events_per_wall_second\": " << s.eventRate
+                << ", \"sim_per_wall\": " << s.ratio << ", \"peak_rss_kb\": " << s.rss << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+private:
+    struct Point {
+        double sim;
+        double wall;
+        uint64_t events;
+        long rss;
+    };
+
+    struct Sample {
+        double sim;
+        double wall;
+        uint64_t events;
+        double eventRate;
+        double ratio;
+        long rss;
+    };
+
+    double Wall() const{
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_runStart).count();
+    }
+
+    void TakeSample(){
+        Point now = {Simulator::Now().GetSeconds(), Wall(), Simulator::GetEventCount(), PeakRssKb()};
+        double wall = now.wall - m_last.wall;
+        double eventRate = wall > 0 ? (now.events - m_last.events) / wall : 0;
+        double ratio = wall > 0 ? (now.sim - m_last.sim) / wall : 0;
+        m_samples.push_back({now.sim, now.wall, now.events - m_startEvents, eventRate, ratio, now.rss});
+        if(m_print){
+            std::cout << "Progress: sim " << now.sim << " s, wall " << now.wall << " s, " << now.events - m_startEvents
+                      << " events, " << static_cast<uint64_t>(eventRate) << " events/s, sim/wall " << ratio
+                      << ", peak RSS " << now.rss / 1024 << " MB" << std::endl;
+        }
+        m_last = now;
+        Simulator::Schedule(m_interval, &SimProfiler::TakeSample, this);
+    }
+
+    static std::string Escape(const std::string& text){
+        std::ostringstream out;
+        for(char c : text){
+            if(c == '"' || c == '\\'){
+                out << '\\';
+            }
+            out << c;
+        }
+        return out.str();
+    }
+
+    Time m_interval;
+    bool m_print = false;
+    std::chrono::steady_clock::time_point m_runStart;
+    uint64_t m_startEvents = 0;
+    Point m_last = {0, 0, 0, 0};
+    std::vector<Sample> m_samples;
+    std::map<std::string, std::string> m_info;
+    std::map<std::string, double> m_values;
+    std::map<std::string, uint64_t> m_eventCounters;
+    std::map<std::string, uint64_t> m_counters;
+    double m_runSeconds = 0;
+    double m_simSeconds = 0;
+    uint64_t m_events = 0;
+};
+
+#endif
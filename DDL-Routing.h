@@ -0,0 +1,216 @@
+#ifndef DDL_ROUTING_H
+#define DDL_ROUTING_H
+
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+// Structural routing for the fat-tree and leaf-spine fabrics.
+//
+// Ipv4GlobalRoutingHelper::PopulateRoutingTables() runs a shortest path
+// computation from every router and installs one route per destination
+// network, which is superlinear in the fabric size and pins every flow to
+// one path. FabricRouting instead derives the next hop from the address plan
+// of DDL-Topology.h: every switch knows the address block below it (host
+// block for a ToR, pod for an aggregation switch, everything for a core or
+// spine) and the interface towards each child. Destinations in the block go
+// down to the child computed from the address; everything else goes up, to
+// an uplink chosen by hashing the flow's 5-tuple with a per-switch seed
+// (per-switch seeds avoid hash polarisation across tiers). Per switch this is
+// one interface list and one cached Ipv4Route per port, so memory and setup
+// are linear in the number of links and forwarding does not allocate.
+//
+// Hosts get a static default route to their switch. Per uplink packet
+// counters show how evenly the hash spreads the traffic.
+
+namespace ns3 {
+
+// Forwarding structure of one switch, filled in by the topology builder.
+struct FabricSwitch {
+    Ptr<Node> node;
+    uint32_t level = 0;              // 0 ToR/leaf, 1 aggregation, 2 core/spine
+    uint32_t prefix = 0;             // address block below the switch
+    uint32_t prefixLength = 8;
+    uint32_t firstChild = 0;         // ToR: host offset of down[0]
+    std::vector<uint32_t> down;      // interface per child
+    std::vector<uint32_t> up;        // interfaces towards the next tier
+};
+
+class FabricRouting : public Ipv4RoutingProtocol {
+public:
+    static TypeId GetTypeId(){
+        static TypeId tid = TypeId("ns3::FabricRouting")
+            .SetParent<Ipv4RoutingProtocol>()
+            .SetGroupName("Internet")
+            .AddConstructor<FabricRouting>();
+        return tid;
+    }
+
+    // Call after the protocol was added to the node's Ipv4ListRouting.
+    void SetSwitch(const FabricSwitch& fabric, uint32_t seed){
+        m_switch = fabric;
+        m_seed = seed;
+        m_mask = m_switch.prefixLength == 0 ? 0 : ~0u << (32 - m_switch.prefixLength);
+        m_routes.assign(m_ipv4->GetNInterfaces(), nullptr);
+        for(uint32_t iface : m_switch.down){
+            m_routes[iface] = MakeRoute(iface);
+        }
+        for(uint32_t iface : m_switch.up){
+            m_routes[iface] = MakeRoute(iface);
+        }
+        m_upPackets.assign(m_switch.up.size(), 0);
+    }
+
+    const FabricSwitch& GetSwitch() const{
+        return m_switch;
+    }
+
+    const std::vector<uint64_t>& GetUplinkPackets() const{
+        return m_upPackets;
+    }
+
+    Ptr<Ipv4Route> RouteOutput(Ptr<Packet> p, const Ipv4Header& header, Ptr<NetDevice> oif, Socket::SocketErrno& sockerr) override{
+        Ptr<Ipv4Route> route = Lookup(p, header);
+        sockerr = route ? Socket::ERROR_NOTERROR : Socket::ERROR_NOROUTETOHOST;
+        return route;
+    }
+
+    bool RouteInput(Ptr<const Packet> p, const Ipv4Header& header, Ptr<const NetDevice> idev, const UnicastForwardCallback& ucb, const MulticastForwardCallback& mcb, const LocalDeliverCallback& lcb, const ErrorCallback& ecb) override{
+        // Local delivery is handled by Ipv4ListRouting before we are asked
+        Ptr<Ipv4Route> route = Lookup(p, header);
+        if(!route){
+            return false;
+        }
+        ucb(route, p, header);
+        return true;
+    }
+
+    void NotifyInterfaceUp(uint32_t) override{}
+    void NotifyInterfaceDown(uint32_t) override{}
+    void NotifyAddAddress(uint32_t, Ipv4InterfaceAddress) override{}
+    void NotifyRemoveAddress(uint32_t, Ipv4InterfaceAddress) override{}
+
+    void SetIpv4(Ptr<Ipv4> ipv4) override{
+        m_ipv4 = ipv4;
+    }
+
+    void PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit = Time::S) const override{
+        std::ostream& os = *stream->GetStream();
+        os << "FabricRouting level " << m_switch.level << ": " << Ipv4Address(m_switch.prefix) << "/" << m_switch.prefixLength
+           << " down " << m_switch.down.size() << " ports, up " << m_switch.up.size() << " ports (ECMP)" << std::endl;
+    }
+
+protected:
+    void DoDispose() override{
+        m_routes.clear();
+        m_ipv4 = nullptr;
+        Ipv4RoutingProtocol::DoDispose();
+    }
+
+private:
+    Ptr<Ipv4Route> MakeRoute(uint32_t iface){
+        Ipv4Address local = m_ipv4->GetAddress(iface, 0).GetLocal();
+        Ptr<Ipv4Route> route = Create<Ipv4Route>();
+        route->SetSource(local);
+        // The other end of the /30 (.1 <-> .2)
+        route->SetGateway(Ipv4Address(local.Get() ^ 3));
+        route->SetOutputDevice(m_ipv4->GetNetDevice(iface));
+        return route;
+    }
+
+    Ptr<Ipv4Route> Lookup(Ptr<const Packet> p, const Ipv4Header& header){
+        uint32_t dst = header.GetDestination().Get();
+        if((dst & m_mask) == m_switch.prefix){
+            uint32_t child = Child(dst);
+            if(child >= m_switch.down.size()){
+                return nullptr;
+            }
+            return m_routes[m_switch.down[child]];
+        }
+        if(m_switch.up.empty()){
+            return nullptr;
+        }
+        uint32_t port = Hash(p, header) % m_switch.up.size();
+        m_upPackets[port]++;
+        return m_routes[m_switch.up[port]];
+    }
+
+    // Child index of a destination inside the block, from the address plan
+    uint32_t Child(uint32_t dst) const{
+        switch(m_switch.level){
+        case 0:
+            // 10.<pod|leaf>.<c>.<d>: host 64 * c + d / 4
+            return ((dst >> 8) & 0xff) * 64 + (dst & 0xff) / 4 - m_switch.firstChild;
+        case 1:
+            return (dst >> 8) & 0xff;
+        default:
+            return (dst >> 16) & 0xff;
+        }
+    }
+
+    uint32_t Hash(Ptr<const Packet> p, const Ipv4Header& header) const{
+        uint32_t ports = 0;
+        uint8_t protocol = header.GetProtocol();
+        if((protocol == 6 || protocol == 17) && p && p->GetSize() >= 4){
+            // Source and destination port are the first 4 bytes of TCP and UDP
+            uint8_t buffer[4];
+            p->CopyData(buffer, 4);
+            ports = (buffer[0] << 24) | (buffer[1] << 16) | (buffer[2] << 8) | buffer[3];
+        }
+        uint64_t h = m_seed;
+        h = Mix(h ^ header.GetSource().Get());
+        h = Mix(h ^ header.GetDestination().Get());
+        h = Mix(h ^ ports);
+        h = Mix(h ^ protocol);
+        return static_cast<uint32_t>(h >> 32);
+    }
+
+    static uint64_t Mix(uint64_t x){
+        // splitmix64 finaliser
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    Ptr<Ipv4> m_ipv4;
+    FabricSwitch m_switch;
+    uint32_t m_mask = 0;
+    uint32_t m_seed = 0;
+    std::vector<Ptr<Ipv4Route>> m_routes;
+    std::vector<uint64_t> m_upPackets;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(FabricRouting);
+
+// Installs FabricRouting on every switch, ahead of the static and global
+// routing already in each node's Ipv4ListRouting, and a default route on
+// every host. Returns the installed protocols.
+inline std::vector<Ptr<FabricRouting>> InstallFabricRouting(const std::vector<FabricSwitch>& switches, const NodeContainer& hosts, uint32_t seed){
+    std::vector<Ptr<FabricRouting>> protocols;
+    protocols.reserve(switches.size());
+    for(const FabricSwitch& fabric : switches){
+        Ptr<Ipv4> ipv4 = fabric.node->GetObject<Ipv4>();
+        Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>(ipv4->GetRoutingProtocol());
+        if(!list){
+            NS_FATAL_ERROR("FabricRouting needs the default Ipv4ListRouting on node " << fabric.node->GetId());
+        }
+        Ptr<FabricRouting> routing = CreateObject<FabricRouting>();
+        list->AddRoutingProtocol(routing, 10);
+        routing->SetSwitch(fabric, seed * 0x9e3779b9u + fabric.node->GetId());
+        protocols.push_back(routing);
+    }
+    Ipv4StaticRoutingHelper staticHelper;
+    for(uint32_t i = 0; i < hosts.GetN(); i++){
+        Ptr<Ipv4> ipv4 = hosts.Get(i)->GetObject<Ipv4>();
+        // Host side of the access /30 is .2, the switch .1
+        Ipv4Address gateway(ipv4->GetAddress(1, 0).GetLocal().Get() ^ 3);
+        staticHelper.GetStaticRouting(ipv4)->SetDefaultRoute(gateway, 1);
+    }
+    return protocols;
+}
+
+} // namespace ns3
+
+#endif
@@ -0,0 +1,192 @@
+#ifndef DDL_SCENARIO_H
+#define DDL_SCENARIO_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/traffic-control-module.h"
+#include "DDL-Pcn.h"
+#include "DDL-DynamicEcn.h"
+
+using namespace ns3;
+
+// Scenario files, transport and AQM selection for DDL-Congestion.
+//
+// A scenario file (--scenario=path) holds one program flag per line as
+// key=value; blank lines and everything after '#' are ignored. Its flags are
+// placed ahead of the command line, so flags given on the command line
+// override the file. Topology, flows, AQM, transport and tracing are all
+// plain flags, so a scenario is just a saved set of them (see scenarios/).
+//
+// --transport picks the TCP congestion control (cubic, dctcp, bbr, newreno,
+// ...) or any ns3::Tcp* type id; --aqm picks the switch queue disc (pfifo,
+// red, codel, fqcodel, pie, fqpie, dynecn). --ecn turns on marking in the AQM
+// and ECN negotiation in TCP (DCTCP always negotiates ECN). --pcn replaces
+// the AQM with PcnQueueDisc, which with --ecn also marks above redMinTh
+// packets. --priority puts a two band PrioQueueDisc in front, each band with
+// its own instance of the AQM; DSCP EF (the training traffic) goes first.
+
+struct TransportConfig {
+    std::string tcp = "cubic";
+    bool ecn = false;
+    uint32_t segmentSize = 1448;
+    uint32_t initialCwnd = 10;
+    uint32_t delAckCount = 1;
+};
+
+struct AqmConfig {
+    std::string type = "pfifo";
+    uint32_t limit = 100;            // packets
+    double redMinTh = 40;            // packets
+    double redMaxTh = 70;
+    double redQw = 0.4;
+    std::string target;              // CoDel/FqCoDel Target, PIE QueueDelayReference, dynecn TargetDelay (empty: default)
+    std::string interval;            // CoDel/FqCoDel Interval, PIE Tupdate, dynecn UpdateInterval (empty: default)
+};
+
+// Program arguments with the flags of the --scenario file (if any) inserted
+// after argv[0].
+inline std::vector<std::string> ScenarioArgs(int argc, char* argv[]){
+    std::vector<std::string> args(argv, argv + argc);
+    std::string path;
+    for(const std::string& arg : args){
+        if(arg.rfind("--scenario=", 0) == 0){
+            path = arg.substr(11);
+        }
+    }
+    if(path.empty()){
+        return args;
+    }
+    std::ifstream in(path);
+    if(!in){
+        NS_FATAL_ERROR("Cannot open scenario file " << path);
+    }
+    std::vector<std::string> flags;
+    std::string line;
+    for(uint32_t number = 1; std::getline(in, line); number++){
+        line = line.substr(0, line.find('#'));
+        size_t first = line.find_first_not_of(" \t\r");
+        if(first == std::string::npos){
+            continue;
+        }
+        line = line.substr(first, line.find_last_not_of(" \t\r") - first + 1);
+        size_t eq = line.find('=');
+        if(eq == std::string::npos || eq == 0){
+            NS_FATAL_ERROR(path << ":" << number << ": expected key=value, got '" << line << "'");
+        }
+        std::string key = line.substr(0, line.find_last_not_of(" \t", eq - 1) + 1);
+        std::string value = line.substr(std::min(line.size(), line.find_first_not_of(" \t", eq + 1)));
+        flags.push_back("--" + key + "=" + value);
+    }
+    args.insert(args.begin() + 1, flags.begin(), flags.end());
+    return args;
+}
+
+inline std::string TcpTypeId(const std::string& name){
+    if(name.rfind("ns3::", 0) == 0){
+        return name;
+    }
+    static const std::vector<std::pair<std::string, std::string>> types = {
+        {"cubic", "ns3::TcpCubic"}, {"dctcp", "ns3::TcpDctcp"}, {"bbr", "ns3::TcpBbr"},
+        {"newreno", "ns3::TcpNewReno"}, {"linuxreno", "ns3::TcpLinuxReno"}, {"bic", "ns3::TcpBic"},
+        {"htcp", "ns3::TcpHtcp"}, {"vegas", "ns3::TcpVegas"}, {"illinois", "ns3::TcpIllinois"},
+        {"westwood", "ns3::TcpWestwoodPlus"}, {"hybla", "ns3::TcpHybla"}, {"highspeed", "ns3::TcpHighSpeed"},
+        {"scalable", "ns3::TcpScalable"}, {"yeah", "ns3::TcpYeah"}, {"veno", "ns3::TcpVeno"}, {"lp", "ns3::TcpLp"},
+    };
+    for(const auto& type : types){
+        if(type.first == name){
+            return type.second;
+        }
+    }
+    NS_FATAL_ERROR("Unknown transport " << name << " (cubic, dctcp, bbr, newreno, ... or an ns3::Tcp* type id)");
+    return "";
+}
+
+inline void ConfigureTransport(const TransportConfig& config){
+    std::string type = TcpTypeId(config.tcp);
+    TypeId tid;
+    if(!TypeId::LookupByNameFailSafe(type, &tid)){
+        NS_FATAL_ERROR("No TCP congestion control " << type << " in this ns-3 build");
+    }
+    Config::SetDefault("ns3::TcpL4Protocol::SocketType", StringValue(type));
+    Config::SetDefault("ns3::TcpSocket::InitialCwnd", UintegerValue(config.initialCwnd));
+    Config::SetDefault("ns3::TcpSocket::SegmentSize", UintegerValue(config.segmentSize));
+    Config::SetDefault("ns3::TcpSocket::DelAckCount", UintegerValue(config.delAckCount));
+    if(type == "ns3::TcpBbr"){
+        // TcpBbr asserts that pacing is on
+        Config::SetDefault("ns3::TcpSocketState::EnablePacing", BooleanValue(true));
+    }
+    if(config.ecn && type != "ns3::TcpDctcp"){
+        Config::SetDefault("ns3::TcpSocketBase::UseEcn", StringValue("On"));
+    }
+}
+
+// Sets the root queue disc of the switch ports. AQM parameters go through
+// Config::SetDefault so the optional ones keep ns-3's defaults when unset.
+inline void ConfigureAqm(TrafficControlHelper& tch, const AqmConfig& config, bool ecn, bool pcn, bool priority, const std::string& linkRate, const std::string& linkDelay){
+    QueueSizeValue limit(QueueSize(QueueSizeUnit::PACKETS, config.limit));
+    if(pcn){
+        tch.SetRootQueueDisc("ns3::PcnQueueDisc",
+                            "MaxSize", limit,
+                            "LinkBandwidth", StringValue(linkRate),
+                            "MarkThreshold", UintegerValue(ecn ? static_cast<uint32_t>(config.redMinTh) : 0));
+        return;
+    }
+    std::string type;
+    std::string targetName = "Target";
+    std::string intervalName = "Interval";
+    if(config.type == "pfifo"){
+        type = "ns3::PfifoFastQueueDisc";
+    }else if(config.type == "red"){
+        type = "ns3::RedQueueDisc";
+        Config::SetDefault("ns3::RedQueueDisc::MinTh", DoubleValue(config.redMinTh));
+        Config::SetDefault("ns3::RedQueueDisc::MaxTh", DoubleValue(config.redMaxTh));
+        Config::SetDefault("ns3::RedQueueDisc::QW", DoubleValue(config.redQw));
+        Config::SetDefault("ns3::RedQueueDisc::LinkBandwidth", StringValue(linkRate));
+        Config::SetDefault("ns3::RedQueueDisc::LinkDelay", StringValue(linkDelay));
+        Config::SetDefault("ns3::RedQueueDisc::MeanPktSize", UintegerValue(1500));
+        Config::SetDefault("ns3::RedQueueDisc::Gentle", BooleanValue(true));
+        Config::SetDefault("ns3::RedQueueDisc::UseHardDrop", BooleanValue(false));
+    }else if(config.type == "codel"){
+        type = "ns3::CoDelQueueDisc";
+    }else if(config.type == "fqcodel"){
+        type = "ns3::FqCoDelQueueDisc";
+    }else if(config.type == "pie" || config.type == "fqpie"){
+        type = config.type == "pie" ? "ns3::PieQueueDisc" : "ns3::FqPieQueueDisc";
+        targetName = "QueueDelayReference";
+        intervalName = "Tupdate";
+    }else if(config.type == "dynecn"){
+        // redMaxTh caps the dynamic threshold, so it never marks later than
+        // the static RED it is compared with
+        type = "ns3::DynamicEcnQueueDisc";
+        targetName = "TargetDelay";
+        intervalName = "UpdateInterval";
+        Config::SetDefault("ns3::DynamicEcnQueueDisc::LinkBandwidth", StringValue(linkRate));
+        Config::SetDefault("ns3::DynamicEcnQueueDisc::MaxThreshold", UintegerValue(static_cast<uint32_t>(config.redMaxTh)));
+    }else{
+        NS_FATAL_ERROR("Unknown AQM " << config.type << " (pfifo, red, codel, fqcodel, pie, fqpie or dynecn)");
+    }
+    if(config.type != "pfifo"){
+        Config::SetDefault(type + "::UseEcn", BooleanValue(ecn));
+        if(config.type != "red"){
+            if(!config.target.empty()){
+                Config::SetDefault(type + "::" + targetName, StringValue(config.target));
+            }
+            if(!config.interval.empty()){
+                Config::SetDefault(type + "::" + intervalName, StringValue(config.interval));
+            }
+        }
+    }
+    if(priority){
+        // Priority 4 (DSCP EF, see kTrainingTos) and 6-7 to band 0
+        uint16_t handle = tch.SetRootQueueDisc("ns3::PrioQueueDisc", "Priomap", StringValue("1 1 1 1 0 1 0 0 1 1 1 1 1 1 1 1"));
+        TrafficControlHelper::ClassIdList classes = tch.AddQueueDiscClasses(handle, 2, "ns3::QueueDiscClass");
+        tch.AddChildQueueDiscs(handle, classes, type, "MaxSize", limit);
+        return;
+    }
+    tch.SetRootQueueDisc(type, "MaxSize", limit);
+}
+
+#endif
@@ -0,0 +1,221 @@
+#ifndef DDL_STATS_H
+#define DDL_STATS_H
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/traffic-control-module.h"
+
+using namespace ns3;
+
+// Streaming tail statistics with memory independent of the run length.
+//
+// LogHistogram is a log-linear (HDR style) histogram: values below 2^SubBits
+// get one bucket each, above that every power of two is split into 2^SubBits
+// buckets, so any quantile is within a relative error of 2^-SubBits (3% for
+// the default 5 bits). With values in ns up to 2^40 (~18 minutes) that is
+// 1,152 counters per histogram, allocated once. Counts can be weighted, which
+// turns the queue length histogram into a time-weighted CDF.
+//
+// RunStats keeps one histogram of transfer completion times and, per traced
+// queue disc, one of per-packet sojourn times (the queue disc's SojournTime
+// trace) and one of queue length weighted by the time spent at each length.
+// Write() stores count, mean, min, max and p50/p90/p99/p99.9 of each, plus the
+// queue length CDF and the non-empty FCT buckets (so the per-rank files of a
+// distributed run can be merged), as a small JSON file.
+
+class LogHistogram {
+public:
+    explicit LogHistogram(uint32_t subBits = 5, uint32_t maxExponent = 40)
+        : m_subBits(subBits), m_sub(1u << subBits), m_max((1ULL << maxExponent) - 1){
+        m_counts.assign((maxExponent - subBits + 1) * m_sub, 0);
+    }
+
+    void Add(uint64_t value, uint64_t weight = 1){
+        if(weight == 0){
+            return;
+        }
+        value = std::min(value, m_max);
+        m_counts[Index(value)] += weight;
+        m_total += weight;
+        m_sum += static_cast<double>(value) * weight;
+        m_minValue = std::min(m_minValue, value);
+        m_maxValue = std::max(m_maxValue, value);
+    }
+
+    uint64_t GetCount() const{
+        return m_total;
+    }
+
+    double GetMean() const{
+        return m_total > 0 ? m_sum / m_total : 0;
+    }
+
+    uint64_t GetMin() const{
+        return m_total > 0 ? m_minValue : 0;
+    }
+
+    uint64_t GetMax() const{
+        return m_maxValue;
+    }
+
+    // Midpoint of the bucket holding the q-quantile, clamped to min/max.
+    double Quantile(double q) const{
+        if(m_total == 0){
+            return 0;
+        }
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * m_total)));
+        uint64_t seen = 0;
+        for(uint32_t i = 0; i < m_counts.size(); i++){
+            seen += m_counts[i];
+            if(seen >= rank){
+                double mid = Low(i) + (Width(i) - 1) / 2.0;
+                return std::min<double>(std::max<double>(mid, m_minValue), m_maxValue);
+            }
+        }
+        return m_maxValue;
+    }
+
+    // (largest value of the bucket, cumulative fraction) per non-empty bucket
+    std::vector<std::pair<double, double>> Cdf() const{
+        std::vector<std::pair<double, double>> cdf;
+        uint64_t seen = 0;
+        for(uint32_t i = 0; i < m_counts.size(); i++){
+            if(m_counts[i] == 0){
+                continue;
+            }
+            seen += m_counts[i];
+            cdf.emplace_back(std::min<double>(Low(i) + Width(i) - 1, m_maxValue), static_cast<double>(seen) / m_total);
+        }
+        return cdf;
+    }
+
+    // (bucket midpoint, count) per non-empty bucket, for merging histograms
+    // of several runs or ranks
+    std::vector<std::pair<double, uint64_t>> Buckets() const{
+        std::vector<std::pair<double, uint64_t>> buckets;
+        for(uint32_t i = 0; i < m_counts.size(); i++){
+            if(m_counts[i] > 0){
+                buckets.emplace_back(Low(i) + (Width(i) - 1) / 2.0, m_counts[i]);
+            }
+        }
+        return buckets;
+    }
+
+private:
+    uint32_t Index(uint64_t value) const{
+        if(value < m_sub){
+            return value;
+        }
+        uint32_t shift = 63 - __builtin_clzll(value) - m_subBits;
+        return (shift + 1) * m_sub + ((value >> shift) - m_sub);
+    }
+
+    uint64_t Low(uint32_t index) const{
+        if(index < m_sub){
+            return index;
+        }
+        uint32_t shift = index / m_sub - 1;
+        return static_cast<uint64_t>(index % m_sub + m_sub) << shift;
+    }
+
+    uint64_t Width(uint32_t index) const{
+        return index < m_sub ? 1 : 1ULL << (index / m_sub - 1);
+    }
+
+    uint32_t m_subBits;
+    uint32_t m_sub;
+    uint64_t m_max;
+    std::vector<uint64_t> m_counts;
+    uint64_t m_total = 0;
+    double m_sum = 0;
+    uint64_t m_minValue = ~0ULL;
+    uint64_t m_maxValue = 0;
+};
+
+class RunStats {
+public:
+    // Transfer completion time, e.g. from a DdlWorkerApp "Transfer" trace.
+    void AddTransfer(Time start, Time end){
+        m_fct.Add((end - start).GetNanoSeconds());
+    }
+
+    void AddQueue(Ptr<QueueDisc> disc, const std::string& name){
+        m_queues.push_back(std::make_unique<Queue>());
+        Queue* q = m_queues.back().get();
+        q->name = name;
+        q->current = disc->GetNPackets();
+        q->lastChange = Simulator::Now();
+        disc->TraceConnectWithoutContext("SojournTime", Callback<void, Time>([q](Time sojourn){
+            q->sojourn.Add(sojourn.GetNanoSeconds());
+        }));
+        disc->TraceConnectWithoutContext("PacketsInQueue", Callback<void, uint32_t, uint32_t>([q](uint32_t, uint32_t length){
+            Time now = Simulator::Now();
+            q->length.Add(q->current, (now - q->lastChange).GetNanoSeconds());
+            q->current = length;
+            q->lastChange = now;
+        }));
+    }
+
+    void Write(const std::string& path){
+        // Close the last queue length segment
+        Time now = Simulator::Now();
+        for(auto& q : m_queues){
+            q->length.Add(q->current, (now - q->lastChange).GetNanoSeconds());
+            q->lastChange = now;
+        }
+        std::ofstream out(path);
+        out << std::setprecision(8);
+        out << "{\n  \"sim_seconds\": " << now.GetSeconds() << ",\n";
+        out << "  \"fct_ms\": ";
+        WriteSummary(out, m_fct, 1e-6);
+        out << ",\n  \"fct_buckets_ms\": [";
+        std::vector<std::pair<double, uint64_t>> buckets = m_fct.Buckets();
+        for(size_t i = 0; i < buckets.size(); i++){
+            out << (i ? ", " : "") << "[" << buckets[i].first * 1e-6 << ", " << buckets[i].second << "]";
+        }
+        out << "]";
+        out << ",\n  \"queues\": {";
+        for(size_t i = 0; i < m_queues.size(); i++){
+            const Queue& q = *m_queues[i];
+            out << (i ? "," : "") << "\n    \"" << q.name << "\": {\n      \"sojourn_us\": ";
+            WriteSummary(out, q.sojourn, 1e-3);
+            out << ",\n      \"length_packets\": ";
+            WriteSummary(out, q.length, 1);
+            out << ",\n      \"length_cdf\": [";
+            std::vector<std::pair<double, double>> cdf = q.length.Cdf();
+            for(size_t j = 0; j < cdf.size(); j++){
+                out << (j ? ", " : "") << "[" << cdf[j].first << ", " << cdf[j].second << "]";
+            }
+            out << "]\n    }";
+        }
+        out << (m_queues.empty() ? "}\n}\n" : "\n  }\n}\n");
+    }
+
+private:
+    struct Queue {
+        std::string name;
+        LogHistogram sojourn;           // ns
+        LogHistogram length;            // packets, weighted by ns
+        uint32_t current = 0;
+        Time lastChange;
+    };
+
+    // count is the number of samples, or ns of simulated time for weighted histograms
+    static void WriteSummary(std::ostream& out, const LogHistogram& h, double scale){
+        out << "{\"count\": " << h.GetCount() << ", \"mean\": " << h.GetMean() * scale
+            << ", \"min\": " << h.GetMin() * scale << ", \"p50\": " << h.Quantile(0.5) * scale
+            << ", \"p90\": " << h.Quantile(0.9) * scale << ", \"p99\": " << h.Quantile(0.99) * scale
+            << ", \"p999\": " << h.Quantile(0.999) * scale << ", \"max\": " << h.GetMax() * scale << "}";
+    }
+
+    LogHistogram m_fct;                 // ns
+    std::vector<std::unique_ptr<Queue>> m_queues;
+};
+
+#endif
@@ -0,0 +1,502 @@
+#ifndef DDL_TOPOLOGY_H
+#define DDL_TOPOLOGY_H
+
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/traffic-control-module.h"
+#include "ns3/nix-vector-routing-module.h"
+#include "DDL-Distributed.h"
+#include "DDL-Profiler.h"
+#include "DDL-Routing.h"
+
+using namespace ns3;
+
+// Topology builder shared by the DDL-Congestion programs.
+//
+// "dumbbell"  - the original 9-node experiment (2 workers, 1 PS, 4 background
+//               hosts, r1 -- r2 bottleneck), wired and addressed exactly as
+//               before so results stay comparable with Results/.
+// "fattree"   - k-ary fat-tree: k pods of k/2 edge and k/2 aggregation
+//               switches, (k/2)^2 core switches. Each edge switch serves
+//               oversubscription * k/2 hosts.
+// "leafspine" - two-tier Clos: every leaf connects to every spine, each leaf
+//               serves oversubscription * spines hosts.
+//
+// Fabric address plan (one /30 per link, derived from the position of the
+// link so no per-link bookkeeping is needed):
+//   host link       10.<pod|leaf>.<edge|h/64>.<4*(h%64)>   switch .1, host .2
+//   edge-agg/leaf-spine 11.<pod|leaf>.<edge|s/64>.<4*(up%64)> lower .1, upper .2
+//   agg-core        12.<pod>.<agg>.<4*j>                   agg .1, core .2
+// which limits fat-trees to k <= 128 with at most 64 hosts per edge switch,
+// and leaf-spine fabrics to 255 leaves with at most 16384 hosts per leaf and
+// 16384 spines.
+//
+// Setup budget: every link costs two devices, one channel, one queue disc per
+// switch port and one /30; addresses are written straight into Ipv4 instead
+// of going through Ipv4AddressHelper, whose allocation list is linear per
+// link. The only per-link state kept after the build is one queue disc and
+// its node per switch port (switchQueues and switchQueueNodes, for queue
+// tracing and PCN), so the builder is O(links) in time and memory. A k=16 fat-tree (1024 hosts, 320 switches)
+// is meant to build in a few seconds; the measured wall time and peak RSS are
+// reported in DdlTopology so the budget can be checked on every run.
+//
+// With config.ranks > 1 every node is created with the MPI system id of the
+// rank that simulates it (see DDL-Distributed.h); links never cross ranks
+// with zero delay.
+
+struct TopologyConfig {
+    std::string type = "dumbbell";
+    uint32_t k = 4;                  // fat-tree arity (even)
+    uint32_t leaves = 4;             // leaf-spine
+    uint32_t spines = 2;
+    double oversubscription = 1.0;   // host-facing : fabric-facing capacity per ToR
+    uint32_t nWorkers = 2;
+    uint32_t nPs = 1;
+    std::string linkRate = "1Gbps";
+    std::string linkDelay = "200us";
+    std::string deviceQueue = "100p";
+    uint32_t ranks = 1;              // MPI ranks to partition the nodes over
+    std::string routing = "global";  // global, fabric or nix
+};
+
+struct DdlTopology {
+    NodeContainer workers;
+    NodeContainer ps;
+    NodeContainer background;
+    NodeContainer switches;
+    std::vector<Ipv4Address> workerAddress;
+    std::vector<Ipv4Address> psAddress;
+    std::vector<Ipv4Address> backgroundAddress;
+    // Queues to trace: the first worker's fabric-facing port(s) first, the
+    // first PS access link last (r1r2 and psr2 in the dumbbell).
+    std::vector<Ptr<QueueDisc>> bottlenecks;
+    std::vector<Ptr<Node>> bottleneckNodes;
+    QueueDiscContainer switchQueues;
+    std::vector<Ptr<Node>> switchQueueNodes;
+    // Per switch tier, address block and ports, for FabricRouting
+    std::vector<FabricSwitch> fabric;
+    uint32_t nHosts = 0;
+    uint32_t nLinks = 0;
+    double setupSeconds = 0;
+    long peakRssKb = 0;
+};
+
+// Writes one /30 onto the two ends of a point-to-point link.
+inline void AssignLink(const NetDeviceContainer& link, uint32_t network){
+    Ipv4Mask mask("255.255.255.252");
+    for(uint32_t i = 0; i < 2; i++){
+        Ptr<NetDevice> dev = link.Get(i);
+        Ptr<Ipv4> ipv4 = dev->GetNode()->GetObject<Ipv4>();
+        int32_t iface = ipv4->GetInterfaceForDevice(dev);
+        if(iface == -1){
+            iface = ipv4->AddInterface(dev);
+        }
+        ipv4->AddAddress(iface, Ipv4InterfaceAddress(Ipv4Address(network + i + 1), mask));
+        ipv4->SetMetric(iface, 1);
+        ipv4->SetUp(iface);
+    }
+}
+
+inline uint32_t Subnet(uint32_t a, uint32_t b, uint32_t c, uint32_t d){
+    return (a << 24) | (b << 16) | (c << 8) | d;
+}
+
+inline uint32_t Interface(Ptr<NetDevice> dev){
+    return dev->GetNode()->GetObject<Ipv4>()->GetInterfaceForDevice(dev);
+}
+
+// Internet stack with Nix-vector routing when requested; otherwise the
+// default static + global list routing (FabricRouting is added later).
+inline InternetStackHelper MakeStack(const TopologyConfig& config){
+    InternetStackHelper stack;
+    if(config.routing == "nix"){
+        Ipv4NixVectorHelper nix;
+        stack.SetRoutingHelper(nix);
+    }
+    return stack;
+}
+
+inline Ptr<QueueDisc> EgressQueue(Ptr<NetDevice> dev){
+    return dev->GetNode()->GetObject<TrafficControlLayer>()->GetRootQueueDiscOnDevice(dev);
+}
+
+inline void AssignRoles(const NodeContainer& hosts, const std::vector<Ipv4Address>& hostAddress, const TopologyConfig& config, DdlTopology& topo){
+    if(config.nPs == 0){
+        NS_FATAL_ERROR("Fabric topologies need at least one parameter server");
+    }
+    if(config.nWorkers + config.nPs > hosts.GetN()){
+        NS_FATAL_ERROR("Topology has " << hosts.GetN() << " hosts, cannot place " << config.nWorkers << " workers and " << config.nPs << " parameter servers");
+    }
+    // Workers fill the fabric from the first pod, parameter servers from the
+    // last one, so worker to PS traffic always crosses the core.
+    uint32_t firstPs = hosts.GetN() - config.nPs;
+    for(uint32_t i = 0; i < hosts.GetN(); i++){
+        if(i < config.nWorkers){
+            topo.workers.Add(hosts.Get(i));
+            topo.workerAddress.push_back(hostAddress[i]);
+        }else if(i >= firstPs){
+            topo.ps.Add(hosts.Get(i));
+            topo.psAddress.push_back(hostAddress[i]);
+        }else{
+            topo.background.Add(hosts.Get(i));
+            topo.backgroundAddress.push_back(hostAddress[i]);
+        }
+    }
+}
+
+inline DdlTopology BuildDumbbell(const TopologyConfig& config, TrafficControlHelper& tch){
+    DdlTopology topo;
+    // r1 side on rank 0, r2 side on rank 1
+    uint32_t r2Rank = config.ranks > 1 ? 1 : 0;
+    NodeContainer router;
+    topo.workers.Create(2, 0);
+    topo.ps.Create(1, r2Rank);
+    router.Create(1, 0);
+    router.Create(1, r2Rank);
+    topo.background.Create(2, 0);
+    topo.background.Create(2, r2Rank);
+    topo.switches = router;
+
+    PointToPointHelper p2p;
+    p2p.SetDeviceAttribute("DataRate", StringValue(config.linkRate));
+    p2p.SetChannelAttribute("Delay", StringValue(config.linkDelay));
+    p2p.SetQueue("ns3::DropTailQueue", "MaxSize", StringValue(config.deviceQueue));
+
+    NetDeviceContainer w1r1, w2r1, r1r2, psr2, b1r1, b2r1, b3r2, b4r2;
+    w1r1 = p2p.Install(router.Get(0), topo.workers.Get(0));
+    w2r1 = p2p.Install(router.Get(0), topo.workers.Get(1));
+    r1r2 = p2p.Install(router.Get(0), router.Get(1));
+    psr2 = p2p.Install(router.Get(1), topo.ps.Get(0));
+    b1r1 = p2p.Install(router.Get(0), topo.background.Get(0));
+    b2r1 = p2p.Install(router.Get(0), topo.background.Get(1));
+    b3r2 = p2p.Install(router.Get(1), topo.background.Get(2));
+    b4r2 = p2p.Install(router.Get(1), topo.background.Get(3));
+
+    InternetStackHelper stack = MakeStack(config);
+    stack.Install(topo.workers);
+    stack.Install(topo.ps);
+    stack.Install(router);
+    stack.Install(topo.background);
+
+    // Queue discs go in before address assignment, otherwise
+    // Ipv4AddressHelper installs the default one on every device.
+    QueueDiscContainer qd1 = tch.Install(r1r2);
+    QueueDiscContainer qd2 = tch.Install(psr2);
+    topo.bottlenecks.push_back(qd1.Get(0));
+    topo.bottlenecks.push_back(qd2.Get(0));
+    topo.bottleneckNodes.push_back(router.Get(0));
+    topo.bottleneckNodes.push_back(router.Get(1));
+    topo.switchQueues.Add(qd1);
+    topo.switchQueues.Add(qd2.Get(0));
+    topo.switchQueueNodes = {router.Get(0), router.Get(1), router.Get(1)};
+
+    Ipv4AddressHelper address;
+    address.SetBase("192.168.1.0", "255.255.255.0");
+    Ipv4InterfaceContainer w1r1Iface = address.Assign(w1r1);
+    address.SetBase("192.168.2.0", "255.255.255.0");
+    Ipv4InterfaceContainer w2r1Iface = address.Assign(w2r1);
+    address.SetBase("192.168.3.0", "255.255.255.0");
+    Ipv4InterfaceContainer psr2Iface = address.Assign(psr2);
+    address.SetBase("192.168.4.0", "255.255.255.0");
+    Ipv4InterfaceContainer r1r2Iface = address.Assign(r1r2);
+    address.SetBase("192.168.5.0", "255.255.255.0");
+    Ipv4InterfaceContainer b1r1Iface = address.Assign(b1r1);
+    address.SetBase("192.168.6.0", "255.255.255.0");
+    Ipv4InterfaceContainer b2r1Iface = address.Assign(b2r1);
+    address.SetBase("192.168.7.0", "255.255.255.0");
+    Ipv4InterfaceContainer b3r2Iface = address.Assign(b3r2);
+    address.SetBase("192.168.8.0", "255.255.255.0");
+    Ipv4InterfaceContainer b4r2Iface = address.Assign(b4r2);
+
+    topo.workerAddress = {w1r1Iface.GetAddress(1), w2r1Iface.GetAddress(1)};
+    topo.psAddress = {psr2Iface.GetAddress(1)};
+    topo.backgroundAddress = {b1r1Iface.GetAddress(1), b2r1Iface.GetAddress(1), b3r2Iface.GetAddress(1), b4r2Iface.GetAddress(1)};
+    topo.nHosts = 7;
+    topo.nLinks = 8;
+    return topo;
+}
+
+inline DdlTopology BuildFatTree(const TopologyConfig& config, TrafficControlHelper& tch){
+    if(config.k < 2 || config.k % 2 != 0 || config.k > 128){
+        NS_FATAL_ERROR("Fat-tree arity k must be even and in [2, 128], got " << config.k);
+    }
+    uint32_t half = config.k / 2;
+    uint32_t hostsPerEdge = std::max<uint32_t>(1, std::lround(config.oversubscription * half));
+    if(hostsPerEdge > 64){
+        NS_FATAL_ERROR("At most 64 hosts per edge switch, got " << hostsPerEdge);
+    }
+    uint32_t pods = config.k;
+
+    DdlTopology topo;
+    // Pods and core switches are dealt round robin over the ranks
+    NodeContainer edge, agg, core, hosts;
+    for(uint32_t i = 0; i < pods * half; i++){
+        edge.Create(1, (i / half) % config.ranks);
+    }
+    for(uint32_t i = 0; i < pods * half; i++){
+        agg.Create(1, (i / half) % config.ranks);
+    }
+    for(uint32_t i = 0; i < half * half; i++){
+        core.Create(1, i % config.ranks);
+    }
+    for(uint32_t i = 0; i < pods * half * hostsPerEdge; i++){
+        hosts.Create(1, (i / (half * hostsPerEdge)) % config.ranks);
+    }
+    topo.switches.Add(edge);
+    topo.switches.Add(agg);
+    topo.switches.Add(core);
+
+    InternetStackHelper stack = MakeStack(config);
+    stack.Install(topo.switches);
+    stack.Install(hosts);
+
+    PointToPointHelper p2p;
+    p2p.SetDeviceAttribute("DataRate", StringValue(config.linkRate));
+    p2p.SetChannelAttribute("Delay", StringValue(config.linkDelay));
+    p2p.SetQueue("ns3::DropTailQueue", "MaxSize", StringValue(config.deviceQueue));
+
+    std::vector<Ipv4Address> hostAddress;
+    hostAddress.reserve(hosts.GetN());
+    NetDeviceContainer ports;
+    std::vector<Ptr<NetDevice>> firstUplinks;
+    Ptr<NetDevice> firstPsPort;
+
+    // Edge switches first, then aggregation, then core, as in topo.switches
+    topo.fabric.resize(topo.switches.GetN());
+    for(uint32_t i = 0; i < topo.switches.GetN(); i++){
+        FabricSwitch& fabric = topo.fabric[i];
+        fabric.node = topo.switches.Get(i);
+        if(i < pods * half){
+            fabric.level = 0;
+            fabric.prefix = Subnet(10, i / half, i % half, 0);
+            fabric.prefixLength = 24;
+            fabric.firstChild = (i % half) * 64;
+        }else if(i < 2 * pods * half){
+            fabric.level = 1;
+            fabric.prefix = Subnet(10, (i - pods * half) / half, 0, 0);
+            fabric.prefixLength = 16;
+        }else{
+            fabric.level = 2;
+            fabric.prefix = Subnet(10, 0, 0, 0);
+            fabric.prefixLength = 8;
+        }
+    }
+    FabricSwitch* edgeFabric = &topo.fabric[0];
+    FabricSwitch* aggFabric = &topo.fabric[pods * half];
+    FabricSwitch* coreFabric = &topo.fabric[2 * pods * half];
+
+    for(uint32_t p = 0; p < pods; p++){
+        for(uint32_t e = 0; e < half; e++){
+            Ptr<Node> tor = edge.Get(p * half + e);
+            for(uint32_t h = 0; h < hostsPerEdge; h++){
+                uint32_t index = (p * half + e) * hostsPerEdge + h;
+                NetDeviceContainer link = p2p.Install(tor, hosts.Get(index));
+                tch.Install(link);
+                AssignLink(link, Subnet(10, p, e, 4 * h));
+                hostAddress.push_back(Ipv4Address(Subnet(10, p, e, 4 * h) + 2));
+                edgeFabric[p * half + e].down.push_back(Interface(link.Get(0)));
+                ports.Add(link.Get(0));
+                if(index == hosts.GetN() - config.nPs){
+                    firstPsPort = link.Get(0);
+                }
+            }
+            for(uint32_t a = 0; a < half; a++){
+                NetDeviceContainer link = p2p.Install(tor, agg.Get(p * half + a));
+                tch.Install(link);
+                AssignLink(link, Subnet(11, p, e, 4 * a));
+                edgeFabric[p * half + e].up.push_back(Interface(link.Get(0)));
+                aggFabric[p * half + a].down.push_back(Interface(link.Get(1)));
+                ports.Add(link);
+                if(p == 0 && e == 0){
+                    firstUplinks.push_back(link.Get(0));
+                }
+            }
+        }
+        for(uint32_t a = 0; a < half; a++){
+            for(uint32_t j = 0; j < half; j++){
+                NetDeviceContainer link = p2p.Install(agg.Get(p * half + a), core.Get(a * half + j));
+                tch.Install(link);
+                AssignLink(link, Subnet(12, p, a, 4 * j));
+                aggFabric[p * half + a].up.push_back(Interface(link.Get(0)));
+                coreFabric[a * half + j].down.push_back(Interface(link.Get(1)));
+                ports.Add(link);
+            }
+        }
+    }
+
+    AssignRoles(hosts, hostAddress, config, topo);
+    for(const Ptr<NetDevice>& dev : firstUplinks){
+        topo.bottlenecks.push_back(EgressQueue(dev));
+        topo.bottleneckNodes.push_back(dev->GetNode());
+    }
+    if(firstPsPort){
+        topo.bottlenecks.push_back(EgressQueue(firstPsPort));
+        topo.bottleneckNodes.push_back(firstPsPort->GetNode());
+    }
+    for(uint32_t i = 0; i < ports.GetN(); i++){
+        topo.switchQueues.Add(EgressQueue(ports.Get(i)));
+        topo.switchQueueNodes.push_back(ports.Get(i)->GetNode());
+    }
+    topo.nHosts = hosts.GetN();
+    topo.nLinks = hosts.GetN() + pods * half * half * 2;
+    return topo;
+}
+
+inline DdlTopology BuildLeafSpine(const TopologyConfig& config, TrafficControlHelper& tch){
+    // Leaf index, host index / 64 and spine index / 64 are address octets
+    if(config.leaves < 1 || config.leaves > 255){
+        NS_FATAL_ERROR("Leaf-spine needs 1..255 leaves, got " << config.leaves);
+    }
+    if(config.spines < 1 || config.spines > 64 * 256){
+        NS_FATAL_ERROR("Leaf-spine needs 1.." << 64 * 256 << " spines, got " << config.spines);
+    }
+    double hostsPerLeafExact = config.oversubscription * config.spines;
+    if(!(hostsPerLeafExact > 0) || hostsPerLeafExact > 64 * 256){
+        NS_FATAL_ERROR("At most " << 64 * 256 << " hosts per leaf (oversubscription * spines), got " << hostsPerLeafExact);
+    }
+    uint32_t hostsPerLeaf = std::max<uint32_t>(1, std::lround(hostsPerLeafExact));
+    uint64_t totalHosts = static_cast<uint64_t>(config.leaves) * hostsPerLeaf;
+    if(totalHosts < config.nWorkers + config.nPs){
+        NS_FATAL_ERROR("Leaf-spine has " << totalHosts << " hosts, cannot place " << config.nWorkers << " workers and " << config.nPs << " parameter servers");
+    }
+
+    DdlTopology topo;
+    NodeContainer leaf, spine, hosts;
+    for(uint32_t l = 0; l < config.leaves; l++){
+        leaf.Create(1, l % config.ranks);
+    }
+    for(uint32_t s = 0; s < config.spines; s++){
+        spine.Create(1, s % config.ranks);
+    }
+    for(uint32_t i = 0; i < config.leaves * hostsPerLeaf; i++){
+        hosts.Create(1, (i / hostsPerLeaf) % config.ranks);
+    }
+    topo.switches.Add(leaf);
+    topo.switches.Add(spine);
+
+    InternetStackHelper stack = MakeStack(config);
+    stack.Install(topo.switches);
+    stack.Install(hosts);
+
+    PointToPointHelper p2p;
+    p2p.SetDeviceAttribute("DataRate", StringValue(config.linkRate));
+    p2p.SetChannelAttribute("Delay", StringValue(config.linkDelay));
+    p2p.SetQueue("ns3::DropTailQueue", "MaxSize", StringValue(config.deviceQueue));
+
+    std::vector<Ipv4Address> hostAddress;
+    hostAddress.reserve(hosts.GetN());
+    NetDeviceContainer ports;
+    std::vector<Ptr<NetDevice>> firstUplinks;
+    Ptr<NetDevice> firstPsPort;
+
+    // Leaves first, then spines, as in topo.switches
+    topo.fabric.resize(topo.switches.GetN());
+    for(uint32_t i = 0; i < topo.switches.GetN(); i++){
+        FabricSwitch& fabric = topo.fabric[i];
+        fabric.node = topo.switches.Get(i);
+        fabric.level = i < config.leaves ? 0 : 2;
+        fabric.prefix = i < config.leaves ? Subnet(10, i, 0, 0) : Subnet(10, 0, 0, 0);
+        fabric.prefixLength = i < config.leaves ? 16 : 8;
+    }
+
+    for(uint32_t l = 0; l < config.leaves; l++){
+        for(uint32_t h = 0; h < hostsPerLeaf; h++){
+            uint32_t index = l * hostsPerLeaf + h;
+            NetDeviceContainer link = p2p.Install(leaf.Get(l), hosts.Get(index));
+            tch.Install(link);
+            uint32_t network = Subnet(10, l, h / 64, 4 * (h % 64));
+            AssignLink(link, network);
+            hostAddress.push_back(Ipv4Address(network + 2));
+            topo.fabric[l].down.push_back(Interface(link.Get(0)));
+            ports.Add(link.Get(0));
+            if(index == hosts.GetN() - config.nPs){
+                firstPsPort = link.Get(0);
+            }
+        }
+        for(uint32_t s = 0; s < config.spines; s++){
+            NetDeviceContainer link = p2p.Install(leaf.Get(l), spine.Get(s));
+            tch.Install(link);
+            AssignLink(link, Subnet(11, l, s / 64, 4 * (s % 64)));
+            topo.fabric[l].up.push_back(Interface(link.Get(0)));
+            topo.fabric[config.leaves + s].down.push_back(Interface(link.Get(1)));
+            ports.Add(link);
+            if(l == 0){
+                firstUplinks.push_back(link.Get(0));
+            }
+        }
+    }
+
+    AssignRoles(hosts, hostAddress, config, topo);
+    for(const Ptr<NetDevice>& dev : firstUplinks){
+        topo.bottlenecks.push_back(EgressQueue(dev));
+        topo.bottleneckNodes.push_back(dev->GetNode());
+    }
+    if(firstPsPort){
+        topo.bottlenecks.push_back(EgressQueue(firstPsPort));
+        topo.bottleneckNodes.push_back(firstPsPort->GetNode());
+    }
+    for(uint32_t i = 0; i < ports.GetN(); i++){
+        topo.switchQueues.Add(EgressQueue(ports.Get(i)));
+        topo.switchQueueNodes.push_back(ports.Get(i)->GetNode());
+    }
+    topo.nHosts = hosts.GetN();
+    topo.nLinks = hosts.GetN() + config.leaves * config.spines;
+    return topo;
+}
+
+// Builds the topology selected by config.type and installs tch as the root
+// queue disc on every switch port. Routing is left to InstallRouting, except
+// that "nix" routing is part of the internet stack.
+inline DdlTopology BuildTopology(const TopologyConfig& config, TrafficControlHelper& tch){
+    auto start = std::chrono::steady_clock::now();
+    if(config.ranks > 1 && Time(config.linkDelay).IsZero()){
+        NS_FATAL_ERROR("Distributed runs need a non-zero link delay as lookahead");
+    }
+    DdlTopology topo;
+    if(config.type == "dumbbell"){
+        topo = BuildDumbbell(config, tch);
+    }else if(config.type == "fattree"){
+        topo = BuildFatTree(config, tch);
+    }else if(config.type == "leafspine"){
+        topo = BuildLeafSpine(config, tch);
+    }else{
+        NS_FATAL_ERROR("Unknown topology " << config.type);
+    }
+    if(config.routing == "fabric" && topo.fabric.empty()){
+        NS_FATAL_ERROR("Fabric routing needs a fattree or leafspine topology");
+    }
+    topo.setupSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    topo.peakRssKb = PeakRssKb();
+    if(LocalRank() == 0){
+        std::cout << "Topology " << config.type << ": " << topo.nHosts << " hosts, " << topo.switches.GetN() << " switches, " << topo.nLinks << " links, built in " << topo.setupSeconds << " s, peak RSS " << topo.peakRssKb / 1024 << " MB" << std::endl;
+    }
+    return topo;
+}
+
+// Fills the forwarding state for config.routing and returns its wall time.
+// "global" runs the all-pairs Ipv4GlobalRoutingHelper computation, "fabric"
+// installs FabricRouting with per-flow ECMP, "nix" computes paths on demand.
+inline double InstallRouting(const TopologyConfig& config, DdlTopology& topo, uint32_t ecmpSeed, std::vector<Ptr<FabricRouting>>& fabricRouting){
+    auto start = std::chrono::steady_clock::now();
+    if(config.routing == "global"){
+        Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    }else if(config.routing == "fabric"){
+        NodeContainer hosts(topo.workers, topo.ps, topo.background);
+        fabricRouting = InstallFabricRouting(topo.fabric, hosts, ecmpSeed);
+    }else if(config.routing != "nix"){
+        NS_FATAL_ERROR("Unknown routing " << config.routing);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if(LocalRank() == 0){
+        std::cout << "Routing " << config.routing << ": " << seconds << " s, peak RSS " << PeakRssKb() / 1024 << " MB" << std::endl;
+    }
+    return seconds;
+}
+
+#endif
@@ -0,0 +1,331 @@
+#ifndef DDL_TRACE_WRITER_H
+#define DDL_TRACE_WRITER_H
+
+#include <charconv>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Buffered columnar trace output.
+//
+// TraceWriter collects rows into preallocated per-column buffers; Append()
+// is a few memcpy's on the simulation thread. Full blocks are handed to one
+// background thread shared by all writers, which either writes them as
+// binary column blocks or formats them as CSV, so neither formatting nor
+// file I/O runs on the event loop. Spent blocks are recycled.
+//
+// Binary layout (".ddlt", native little-endian):
+//   "DDLT" | u32 version | u32 columns | per column: u8 type, u16 name length, name
+//   then blocks of: u32 rows | column 0 values | column 1 values | ...
+// Files with the same header can be concatenated by appending their blocks.
+// tracereader.py reads both formats and converts binary traces to CSV.
+// Arrow/Parquet would need libraries that are not part of an ns-3 build, so
+// the format is kept self-contained.
+
+class TraceWriter {
+public:
+    enum Type : uint8_t { U32 = 0, U64 = 1, F64 = 2, IPV4 = 3 };
+
+    struct Column {
+        std::string name;
+        Type type;
+    };
+
+    static constexpr uint32_t kVersion = 1;
+
+    static const char* Extension(bool binary){
+        return binary ? ".ddlt" : ".csv";
+    }
+
+    // Constructing the flusher first makes it outlive every writer, global
+    // ones included, whose destructors still close through it
+    TraceWriter(){
+        Flusher::Get();
+    }
+
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    ~TraceWriter(){
+        Close();
+    }
+
+    void Open(const std::string& path, const std::vector<Column>& columns, bool binary, uint32_t blockRows = 8192){
+        Close();
+        m_columns = columns;
+        m_binary = binary;
+        m_blockRows = blockRows;
+        m_rows = 0;
+        m_out.open(path, binary ? std::ios::binary : std::ios::out);
+        if(binary){
+            m_out.write("DDLT", 4);
+            WritePod(kVersion);
+            WritePod(static_cast<uint32_t>(columns.size()));
+            for(const Column& column : columns){
+                WritePod(static_cast<uint8_t>(column.type));
+                WritePod(static_cast<uint16_t>(column.name.size()));
+                m_out.write(column.name.data(), column.name.size());
+            }
+        }else{
+            for(size_t i = 0; i < columns.size(); i++){
+                m_out << (i ? "," : "") << columns[i].name;
+            }
+            m_out << "\n";
+        }
+        // Two blocks up front so the writer double-buffers without allocating
+        m_free.push_back(NewBlock());
+        m_free.push_back(NewBlock());
+        m_block = TakeBlock();
+    }
+
+    bool IsOpen() const{
+        return m_out.is_open();
+    }
+
+    template <typename... Args>
+    void Append(Args... values){
+        size_t col = 0;
+        (Put(col++, values), ...);
+        if(++m_rows == m_blockRows){
+            Submit();
+        }
+    }
+
+    // Row whose columns are only known at run time (values in column order).
+    void AppendRow(const double* values, size_t n){
+        for(size_t col = 0; col < n; col++){
+            Put(col, values[col]);
+        }
+        if(++m_rows == m_blockRows){
+            Submit();
+        }
+    }
+
+    // Flushes the partial block and waits until everything is on disk.
+    void Close(){
+        if(!m_out.is_open()){
+            return;
+        }
+        if(m_rows > 0){
+            Submit();
+        }
+        Flusher::Get().Wait(this);
+        Flusher::Get().Forget(this);
+        m_out.close();
+        m_block.reset();
+        m_free.clear();
+    }
+
+private:
+    struct Block {
+        std::vector<std::vector<uint8_t>> data;
+        uint32_t rows = 0;
+    };
+
+    // Background thread shared by every writer
+    class Flusher {
+    public:
+        static Flusher& Get(){
+            static Flusher flusher;
+            return flusher;
+        }
+
+        void Push(TraceWriter* writer, std::unique_ptr<Block> block){
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobs.emplace_back(writer, std::move(block));
+            m_pending[writer]++;
+            m_wake.notify_one();
+        }
+
+        void Wait(TraceWriter* writer){
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done.wait(lock, [&]{ return m_pending[writer] == 0; });
+            m_pending.erase(writer);
+        }
+
+        std::unique_ptr<Block> Recycled(TraceWriter* writer){
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto& free = m_recycled[writer];
+            if(free.empty()){
+                return nullptr;
+            }
+            std::unique_ptr<Block> block = std::move(free.back());
+            free.pop_back();
+            return block;
+        }
+
+        void Forget(TraceWriter* writer){
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_recycled.erase(writer);
+        }
+
+    private:
+        Flusher()
+            : m_thread(&Flusher::Run, this){
+        }
+
+        ~Flusher(){
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+                m_wake.notify_one();
+            }
+            m_thread.join();
+        }
+
+        void Run(){
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while(true){
+                m_wake.wait(lock, [&]{ return m_stop || !m_jobs.empty(); });
+                if(m_jobs.empty()){
+                    return;
+                }
+                auto job = std::move(m_jobs.front());
+                m_jobs.pop_front();
+                lock.unlock();
+                job.first->WriteBlock(*job.second);
+                job.second->rows = 0;
+                lock.lock();
+                m_recycled[job.first].push_back(std::move(job.second));
+                if(--m_pending[job.first] == 0){
+                    m_done.notify_all();
+                }
+            }
+        }
+
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_done;
+        std::deque<std::pair<TraceWriter*, std::unique_ptr<Block>>> m_jobs;
+        std::map<TraceWriter*, uint32_t> m_pending;
+        std::map<TraceWriter*, std::vector<std::unique_ptr<Block>>> m_recycled;
+        bool m_stop = false;
+        std::thread m_thread;
+    };
+
+    static size_t Width(Type type){
+        return (type == U64 || type == F64) ? 8 : 4;
+    }
+
+    template <typename T>
+    void WritePod(T value){
+        m_out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    void Put(size_t col, T value){
+        uint8_t* dst = m_block->data[col].data() + m_rows * Width(m_columns[col].type);
+        switch(m_columns[col].type){
+        case U32:
+        case IPV4: {
+            uint32_t v = static_cast<uint32_t>(value);
+            std::memcpy(dst, &v, 4);
+            break;
+        }
+        case U64: {
+            uint64_t v = static_cast<uint64_t>(value);
+            std::memcpy(dst, &v, 8);
+            break;
+        }
+        case F64: {
+            double v = static_cast<double>(value);
+            std::memcpy(dst, &v, 8);
+            break;
+        }
+        }
+    }
+
+    std::unique_ptr<Block> NewBlock() const{
+        auto block = std::make_unique<Block>();
+        for(const Column& column : m_columns){
+            block->data.emplace_back(m_blockRows * Width(column.type));
+        }
+        return block;
+    }
+
+    std::unique_ptr<Block> TakeBlock(){
+        if(!m_free.empty()){
+            std::unique_ptr<Block> block = std::move(m_free.back());
+            m_free.pop_back();
+            return block;
+        }
+        std::unique_ptr<Block> block = Flusher::Get().Recycled(this);
+        return block ? std::move(block) : NewBlock();
+    }
+
+    void Submit(){
+        m_block->rows = m_rows;
+        Flusher::Get().Push(this, std::move(m_block));
+        m_rows = 0;
+        m_block = TakeBlock();
+    }
+
+    // Runs on the flusher thread.
+    void WriteBlock(const Block& block){
+        if(m_binary){
+            WritePod(block.rows);
+            for(size_t c = 0; c < m_columns.size(); c++){
+                m_out.write(reinterpret_cast<const char*>(block.data[c].data()), block.rows * Width(m_columns[c].type));
+            }
+            return;
+        }
+        std::ostringstream text;
+        for(uint32_t r = 0; r < block.rows; r++){
+            for(size_t c = 0; c < m_columns.size(); c++){
+                const uint8_t* src = block.data[c].data() + r * Width(m_columns[c].type);
+                if(c){
+                    text << ",";
+                }
+                switch(m_columns[c].type){
+                case U32: {
+                    uint32_t v;
+                    std::memcpy(&v, src, 4);
+                    text << v;
+                    break;
+                }
+                case IPV4: {
+                    uint32_t v;
+                    std::memcpy(&v, src, 4);
+                    text << (v >> 24) << "." << ((v >> 16) & 0xff) << "." << ((v >> 8) & 0xff) << "." << (v & 0xff);
+                    break;
+                }
+                case U64: {
+                    uint64_t v;
+                    std::memcpy(&v, src, 8);
+                    text << v;
+                    break;
+                }
+                case F64: {
+                    // Shortest form that reads back exactly, as in the binary format
+                    double v;
+                    std::memcpy(&v, src, 8);
+                    char digits[32];
+                    text.write(digits, std::to_chars(digits, digits + sizeof(digits), v).ptr - digits);
+                    break;
+                }
+                }
+            }
+            text << "\n";
+        }
+        m_out << text.str();
+    }
+
+    std::vector<Column> m_columns;
+    bool m_binary = false;
+    uint32_t m_blockRows = 0;
+    uint32_t m_rows = 0;
+    std::ofstream m_out;
+    std::unique_ptr<Block> m_block;
+    std::vector<std::unique_ptr<Block>> m_free;
+};
+
+#endif
@@ -0,0 +1,966 @@
+#ifndef DDL_TRAINING_H
+#define DDL_TRAINING_H
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+// Data-parallel training traffic.
+//
+// DdlWorkerApp models training iterations instead of a fixed on/off pattern.
+// An iteration is a forward pass followed by a backward pass that finishes
+// one layer at a time, last layer first. Each layer's gradient is handed to
+// the network as soon as it is ready (wait-free backprop), so communication
+// overlaps the rest of the backward pass. Two synchronisation modes:
+//   - parameter server: layers are sharded round robin over the PSs; the
+//     worker pushes each gradient to its PS over TCP and the iteration's
+//     communication ends when every PS has sent back its updated shard. A
+//     DdlPsApp waits for the shard from all of its workers before replying.
+//   - ring all-reduce: gradients are grouped into buckets (BucketSize) and
+//     each bucket is all-reduced as in NCCL, 2(N-1) steps of bucket/N bytes
+//     to the next worker, each step waiting for the previous worker's chunk.
+// The next iteration starts when both the backward pass and the
+// communication are done. The Iteration trace reports, per iteration, its
+// start, the first gradient hand-off, the end of compute and the end of
+// communication, from which iteration time and overlap follow. The Transfer
+// trace reports the completion time of each gradient transfer: per PS, from
+// the first push of its shard until the updated shard is back; per ring
+// bucket, from the bucket closing until its all-reduce has been received.
+//
+// Layer sizes are the fp32 gradients of the named models, grouped by block.
+//
+// Communication scheduling (parameter server mode, see CommSchedule):
+//   - ChunkSize splits gradients into chunks kept in a per-PS queue ordered
+//     by layer, first layer first (the order the next forward pass needs
+//     them, as in ByteScheduler/TicTac). A chunk is handed to TCP only once
+//     the previous one has gone into the socket buffer, so a layer that
+//     becomes ready later but is needed earlier overtakes the queued ones.
+//   - A DdlPushCoordinator per PS hands out tokens: at most MaxPushers
+//     workers push a chunk to the PS at a time, the others wait in FIFO
+//     order, which interleaves the workers' pushes instead of letting all of
+//     them burst into the PS link together. Requests and grants take
+//     ControlDelay to travel. The coordinator also knows the chunk layout of
+//     every stream, so the PS replies per layer as soon as every worker's
+//     copy of it is in, and the worker's next forward pass starts a layer as
+//     soon as that layer's update is back instead of waiting for all of them.
+//   - Tos sets the IP TOS of the training sockets, so priority queues at the
+//     switches can serve gradients ahead of other traffic.
+
+namespace ns3 {
+
+struct ModelProfile {
+    std::string name;
+    std::vector<uint64_t> layerBytes;   // forward order
+    Time computeTime;                   // forward + backward per iteration
+
+    uint64_t TotalBytes() const{
+        uint64_t total = 0;
+        for(uint64_t bytes : layerBytes){
+            total += bytes;
+        }
+        return total;
+    }
+};
+
+// Parameter counts per block: ResNet-50 (conv1, 16 bottlenecks, fc),
+// BERT-base (embeddings, 12 encoder layers, pooler), VGG-16 (13 conv, 3 fc).
+// scale multiplies every tensor, e.g. 0.5 for fp16 gradients.
+inline ModelProfile GetModelProfile(const std::string& name, double scale = 1.0){
+    ModelProfile profile;
+    profile.name = name;
+    std::vector<uint64_t> params;
+    if(name == "resnet50"){
+        params = {9408, 75008, 70400, 70400, 379392, 280064, 280064, 280064,
+                  1512448, 1117184, 1117184, 1117184, 1117184, 1117184,
+                  6039552, 4462592, 4462592, 2049000};
+        profile.computeTime = MilliSeconds(100);
+    }else if(name == "bert"){
+        params = {23837184};
+        params.insert(params.end(), 12, 7087872);
+        params.push_back(590592);
+        profile.computeTime = MilliSeconds(300);
+    }else if(name == "vgg16"){
+        params = {1792, 36928, 73856, 147584, 295168, 590080, 590080, 1180160,
+                  2359808, 2359808, 2359808, 2359808, 2359808,
+                  102764544, 16781312, 4097000};
+        profile.computeTime = MilliSeconds(150);
+    }else{
+        NS_FATAL_ERROR("Unknown model profile " << name << " (resnet50, bert or vgg16)");
+    }
+    for(uint64_t p : params){
+        profile.layerBytes.push_back(std::max<uint64_t>(1, static_cast<uint64_t>(p * 4 * scale)));
+    }
+    return profile;
+}
+
+// Hands a byte count to a TCP socket as fast as its send buffer allows,
+// optionally limited to a rate in quanta of kQuantum bytes.
+class GradientStream {
+public:
+    static constexpr uint32_t kQuantum = 65536;
+
+    void Attach(Ptr<Socket> socket){
+        m_socket = socket;
+        m_socket->SetSendCallback(Callback<void, Ptr<Socket>, uint32_t>([this](Ptr<Socket>, uint32_t){
+            Pump();
+        }));
+    }
+
+    void Push(uint64_t bytes){
+        m_pending += bytes;
+        Pump();
+    }
+
+    // Called whenever everything pushed so far has gone into the socket.
+    void SetDrainCallback(Callback<void> drained){
+        m_drained = drained;
+    }
+
+    // A zero rate means unlimited.
+    void SetRate(DataRate rate){
+        m_rate = rate;
+        m_refill.Cancel();
+        m_credit = kQuantum;
+        Pump();
+    }
+
+    void Close(){
+        m_refill.Cancel();
+        m_pending = 0;
+        m_drained = MakeNullCallback<void>();
+        if(m_socket){
+            m_socket->SetSendCallback(MakeNullCallback<void, Ptr<Socket>, uint32_t>());
+            m_socket->Close();
+            m_socket = nullptr;
+        }
+    }
+
+private:
+    void Pump(){
+        bool limited = m_rate.GetBitRate() > 0;
+        while(m_socket && m_pending > 0){
+            uint64_t size = std::min<uint64_t>(m_pending, m_socket->GetTxAvailable());
+            if(limited){
+                if(m_credit == 0){
+                    if(!m_refill.IsPending()){
+                        m_refill = Simulator::Schedule(m_rate.CalculateBytesTxTime(kQuantum), &GradientStream::Refill, this);
+                    }
+                    return;
+                }
+                size = std::min<uint64_t>(size, m_credit);
+            }
+            if(size == 0){
+                return;
+            }
+            int sent = m_socket->Send(Create<Packet>(static_cast<uint32_t>(size)));
+            if(sent <= 0){
+                return;
+            }
+            m_pending -= sent;
+            if(limited){
+                m_credit -= std::min<uint64_t>(m_credit, sent);
+            }
+            if(m_pending == 0 && !m_drained.IsNull()){
+                m_drained();
+            }
+        }
+    }
+
+    void Refill(){
+        m_credit = kQuantum;
+        Pump();
+    }
+
+    Ptr<Socket> m_socket;
+    uint64_t m_pending = 0;
+    DataRate m_rate;
+    uint64_t m_credit = kQuantum;
+    EventId m_refill;
+    Callback<void> m_drained;
+};
+
+struct CommSchedule {
+    uint32_t chunkSize = 0;             // bytes, 0: whole layers
+    uint32_t tokens = 0;                // concurrent pushers per PS, 0: no coordination
+    bool priority = false;              // DSCP EF on the training sockets
+};
+
+// DSCP EF; Socket::IpTos2Priority maps it to priority 4
+static constexpr uint8_t kTrainingTos = 0xb8;
+
+// Push tokens and chunk layout for one parameter server. Worker side calls
+// are Request, Sent and ReplyReceived; PS side calls are Received and
+// Replied. Both sides run in the same process, so --distributed is not
+// supported.
+class DdlPushCoordinator : public Object {
+public:
+    static TypeId GetTypeId(){
+        static TypeId tid = TypeId("ns3::DdlPushCoordinator")
+            .SetParent<Object>()
+            .SetGroupName("Applications")
+            .AddConstructor<DdlPushCoordinator>()
+            .AddAttribute("MaxPushers", "Workers that may push a chunk to the PS at the same time",
+                          UintegerValue(1),
+                          MakeUintegerAccessor(&DdlPushCoordinator::m_maxPushers),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("ControlDelay", "Time for a token request or grant to reach the other side",
+                          TimeValue(MicroSeconds(600)),
+                          MakeTimeAccessor(&DdlPushCoordinator::m_controlDelay),
+                          MakeTimeChecker())
+            .AddAttribute("ReleaseBytes", "Hand the token on when this many bytes of the chunk are still to arrive, hiding the grant delay",
+                          UintegerValue(65536),
+                          MakeUintegerAccessor(&DdlPushCoordinator::m_releaseBytes),
+                          MakeUintegerChecker<uint32_t>())
+            .AddTraceSource("Grant", "A worker was granted a push token",
+                            MakeTraceSourceAccessor(&DdlPushCoordinator::m_grantTrace),
+                            "ns3::DdlPushCoordinator::GrantTracedCallback");
+        return tid;
+    }
+
+    // worker, workers waiting behind it
+    typedef void (*GrantTracedCallback)(uint32_t, uint32_t);
+
+    void AddWorker(uint32_t worker, Callback<void> grant, Callback<void, uint32_t> update){
+        if(worker >= m_workers.size()){
+            m_workers.resize(worker + 1);
+        }
+        m_workers[worker].grant = grant;
+        m_workers[worker].update = update;
+    }
+
+    // PS side: a chunk of (worker, layer, bytes) has fully arrived.
+    void SetChunkCallback(Callback<void, uint32_t, uint32_t, uint64_t> chunk){
+        m_chunk = chunk;
+    }
+
+    void Request(uint32_t worker){
+        Simulator::Schedule(m_controlDelay, &DdlPushCoordinator::Enqueue, this, worker);
+    }
+
+    // The chunk a granted worker hands to TCP; in a real system its header.
+    void Sent(uint32_t worker, uint32_t layer, uint64_t bytes){
+        m_workers[worker].pushes.push_back({layer, bytes, false});
+    }
+
+    void Received(uint32_t worker, uint64_t bytes){
+        Worker& w = m_workers[worker];
+        w.pushRx += bytes;
+        while(!w.pushes.empty()){
+            Frame& frame = w.pushes.front();
+            if(!frame.released && w.pushRx + m_releaseBytes >= frame.bytes){
+                frame.released = true;
+                m_pushing--;
+                Dispatch();
+            }
+            if(w.pushRx < frame.bytes){
+                break;
+            }
+            w.pushRx -= frame.bytes;
+            Frame done = frame;
+            w.pushes.pop_front();
+            if(!m_chunk.IsNull()){
+                m_chunk(worker, done.layer, done.bytes);
+            }
+        }
+    }
+
+    // The PS sends the update of layer to every worker.
+    void Replied(uint32_t layer, uint64_t bytes){
+        for(Worker& w : m_workers){
+            w.replies.push_back({layer, bytes, false});
+        }
+    }
+
+    void ReplyReceived(uint32_t worker, uint64_t bytes){
+        Worker& w = m_workers[worker];
+        w.replyRx += bytes;
+        while(!w.replies.empty() && w.replyRx >= w.replies.front().bytes){
+            Frame done = w.replies.front();
+            w.replyRx -= done.bytes;
+            w.replies.pop_front();
+            if(!w.update.IsNull()){
+                w.update(done.layer);
+            }
+        }
+    }
+
+protected:
+    void DoDispose() override{
+        m_workers.clear();
+        m_chunk = MakeNullCallback<void, uint32_t, uint32_t, uint64_t>();
+        Object::DoDispose();
+    }
+
+private:
+    struct Frame {
+        uint32_t layer;
+        uint64_t bytes;
+        bool released;
+    };
+
+    struct Worker {
+        Callback<void> grant;
+        Callback<void, uint32_t> update;
+        std::deque<Frame> pushes;
+        std::deque<Frame> replies;
+        uint64_t pushRx = 0;
+        uint64_t replyRx = 0;
+    };
+
+    void Enqueue(uint32_t worker){
+        m_waiting.push_back(worker);
+        Dispatch();
+    }
+
+    void Dispatch(){
+        while(m_pushing < m_maxPushers && !m_waiting.empty()){
+            uint32_t worker = m_waiting.front();
+            m_waiting.pop_front();
+            m_pushing++;
+            m_grantTrace(worker, m_waiting.size());
+            Simulator::Schedule(m_controlDelay, &DdlPushCoordinator::Grant, this, worker);
+        }
+    }
+
+    void Grant(uint32_t worker){
+        if(worker < m_workers.size() && !m_workers[worker].grant.IsNull()){
+            m_workers[worker].grant();
+        }
+    }
+
+    uint32_t m_maxPushers;
+    Time m_controlDelay;
+    uint32_t m_releaseBytes;
+    std::vector<Worker> m_workers;
+    std::deque<uint32_t> m_waiting;
+    uint32_t m_pushing = 0;
+    Callback<void, uint32_t, uint32_t, uint64_t> m_chunk;
+    TracedCallback<uint32_t, uint32_t> m_grantTrace;
+};
+
+class DdlWorkerApp : public Application {
+public:
+    static TypeId GetTypeId(){
+        static TypeId tid = TypeId("ns3::DdlWorkerApp")
+            .SetParent<Application>()
+            .SetGroupName("Applications")
+            .AddConstructor<DdlWorkerApp>()
+            .AddAttribute("ComputeTime", "Forward plus backward time per iteration (zero: the model's default)",
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&DdlWorkerApp::m_computeTime),
+                          MakeTimeChecker())
+            .AddAttribute("ForwardFraction", "Share of the compute time spent in the forward pass",
+                          DoubleValue(1.0 / 3),
+                          MakeDoubleAccessor(&DdlWorkerApp::m_forwardFraction),
+                          MakeDoubleChecker<double>(0, 1))
+            .AddAttribute("Iterations", "Iterations to run, zero for no limit",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&DdlWorkerApp::m_iterations),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("BucketSize", "Ring all-reduce bucket size in bytes",
+                          UintegerValue(25 * 1024 * 1024),
+                          MakeUintegerAccessor(&DdlWorkerApp::m_bucketSize),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("Port", "Port of the PSs and of the ring neighbour",
+                          UintegerValue(5000),
+                          MakeUintegerAccessor(&DdlWorkerApp::m_port),
+                          MakeUintegerChecker<uint16_t>())
+            .AddAttribute("ChunkSize", "Parameter server mode: push gradients in chunks of this many bytes, first layer first (0: whole gradients as they become ready)",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&DdlWorkerApp::m_chunkSize),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("Tos", "IP TOS of the training sockets",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&DdlWorkerApp::m_tos),
+                          MakeUintegerChecker<uint8_t>())
+            .AddTraceSource("Iteration", "An iteration finished: index, start, first send, compute end, communication end",
+                            MakeTraceSourceAccessor(&DdlWorkerApp::m_iterationTrace),
+                            "ns3::DdlWorkerApp::IterationTracedCallback")
+            .AddTraceSource("PeerRx", "Data received from a PS or the previous ring worker",
+                            MakeTraceSourceAccessor(&DdlWorkerApp::m_peerRxTrace),
+                            "ns3::DdlWorkerApp::PeerRxTracedCallback")
+            .AddTraceSource("Transfer", "A gradient transfer completed: peer, start, end, bytes",
+                            MakeTraceSourceAccessor(&DdlWorkerApp::m_transferTrace),
+                            "ns3::DdlWorkerApp::TransferTracedCallback");
+        return tid;
+    }
+
+    void SetModel(const ModelProfile& model){
+        m_model = model;
+    }
+
+    // Parameter server mode: one connection per PS, layers sharded over them.
+    void SetParameterServers(const std::vector<Ipv4Address>& ps){
+        m_ring = false;
+        m_peers = ps;
+    }
+
+    // Parameter server mode: push through the PSs' coordinators (same order
+    // as the PSs) as the worker with the given index.
+    void SetCoordinators(const std::vector<Ptr<DdlPushCoordinator>>& coordinators, uint32_t index){
+        m_coordinators = coordinators;
+        m_index = index;
+    }
+
+    // Ring mode: the ring size and the next worker, which this one feeds.
+    void SetRing(uint32_t size, Ipv4Address next){
+        m_ring = true;
+        m_ringSize = size;
+        m_peers = {next};
+    }
+
+    void SetRate(DataRate rate){
+        m_rate = rate;
+        for(GradientStream& stream : m_streams){
+            stream.SetRate(rate);
+        }
+    }
+
+protected:
+    void DoDispose() override{
+        m_streams.clear();
+        m_coordinators.clear();
+        m_listener = nullptr;
+        m_inbound = nullptr;
+        Application::DoDispose();
+    }
+
+private:
+    void StartApplication() override{
+        m_running = true;
+        if(m_computeTime.IsZero()){
+            m_computeTime = m_model.computeTime;
+        }
+        m_scheduled = !m_ring && (m_chunkSize > 0 || !m_coordinators.empty());
+        m_layerWise = !m_ring && !m_coordinators.empty();
+        m_streams.resize(m_peers.size());
+        for(uint32_t p = 0; p < m_peers.size(); p++){
+            Ptr<Socket> socket = Socket::CreateSocket(GetNode(), TcpSocketFactory::GetTypeId());
+            socket->SetIpTos(m_tos);
+            socket->Bind();
+            socket->Connect(InetSocketAddress(m_peers[p], m_port));
+            if(!m_ring){
+                socket->SetRecvCallback(Callback<void, Ptr<Socket>>([this, p](Ptr<Socket> s){
+                    Receive(p, s);
+                }));
+            }
+            m_streams[p].Attach(socket);
+            m_streams[p].SetRate(m_rate);
+            if(m_scheduled){
+                m_streams[p].SetDrainCallback(Callback<void>([this, p](){
+                    m_sending[p] = false;
+                    // Not from inside Pump: with small chunks every push
+                    // would drain at once and recurse
+                    Simulator::ScheduleNow(&DdlWorkerApp::SendNext, this, p);
+                }));
+            }
+            if(m_layerWise){
+                m_coordinators[p]->AddWorker(m_index, Callback<void>([this, p](){
+                    // A grant can still arrive after the app stopped
+                    if(m_running){
+                        PushChunk(p);
+                    }
+                }), Callback<void, uint32_t>([this](uint32_t layer){
+                    LayerUpdated(layer);
+                }));
+            }
+        }
+        m_ready.assign(m_peers.size(), std::map<uint32_t, uint64_t>());
+        m_sending.assign(m_peers.size(), false);
+        m_forwardLayer = m_model.layerBytes.size();
+        m_rx.assign(m_peers.size(), 0);
+        m_shardBytes.assign(m_peers.size(), 0);
+        for(uint32_t l = 0; l < m_model.layerBytes.size(); l++){
+            m_shardBytes[l % m_peers.size()] += m_model.layerBytes[l];
+        }
+        if(m_ring){
+            // The previous worker connects to us
+            m_listener = Socket::CreateSocket(GetNode(), TcpSocketFactory::GetTypeId());
+            m_listener->SetIpTos(m_tos);
+            m_listener->Bind(InetSocketAddress(Ipv4Address::GetAny(), m_port));
+            m_listener->Listen();
+            m_listener->SetAcceptCallback(MakeNullCallback<bool, Ptr<Socket>, const Address&>(),
+                                          Callback<void, Ptr<Socket>, const Address&>([this](Ptr<Socket> s, const Address&){
+                m_inbound = s;
+                s->SetRecvCallback(Callback<void, Ptr<Socket>>([this](Ptr<Socket> s){
+                    Receive(0, s);
+                }));
+            }));
+        }
+        StartIteration();
+    }
+
+    void StopApplication() override{
+        m_running = false;
+        m_event.Cancel();
+        m_forwardEvent.Cancel();
+        for(GradientStream& stream : m_streams){
+            stream.Close();
+        }
+        if(m_listener){
+            m_listener->Close();
+        }
+        if(m_inbound){
+            m_inbound->Close();
+        }
+    }
+
+    void StartIteration(){
+        ResetIteration(Simulator::Now());
+        m_event = Simulator::Schedule(Seconds(m_computeTime.GetSeconds() * m_forwardFraction), &DdlWorkerApp::BackwardLayer, this);
+    }
+
+    void ResetIteration(Time start){
+        m_start = start;
+        m_firstSend = Time::Max();
+        m_computeDone = false;
+        m_layer = m_model.layerBytes.size();
+        m_steps.clear();
+        m_stepPrefix.clear();
+        m_stepFirst.clear();
+        m_nextStep = 0;
+        m_stepTotal = 0;
+        m_bucket = 0;
+        m_transferStart.assign(m_peers.size(), Time::Max());
+        m_transferDone.assign(m_peers.size(), false);
+        m_bucketStart.clear();
+        m_bucketEnd.clear();
+        m_bucketBytes.clear();
+        m_nextBucket = 0;
+        m_updated.assign(m_model.layerBytes.size(), false);
+        m_updatesLeft = m_model.layerBytes.size();
+        m_shardLeft = m_shardBytes;
+    }
+
+    // Called once per layer, last layer first.
+    void BackwardLayer(){
+        if(m_layer < m_model.layerBytes.size()){
+            GradientReady(m_layer, m_model.layerBytes[m_layer]);
+        }
+        if(m_layer == 0){
+            m_computeEnd = Simulator::Now();
+            m_computeDone = true;
+            if(m_ring){
+                CloseBucket();
+            }
+            if(m_layerWise && (m_iterations == 0 || m_done + 1 < m_iterations)){
+                // The next forward pass follows the layer updates
+                m_forwardLayer = 0;
+                m_forwardStart = Time::Max();
+            }
+            CheckDone();
+            Forward();
+            return;
+        }
+        m_layer--;
+        Time step = Seconds(m_computeTime.GetSeconds() * (1 - m_forwardFraction) / m_model.layerBytes.size());
+        m_event = Simulator::Schedule(step, &DdlWorkerApp::BackwardLayer, this);
+    }
+
+    void GradientReady(uint32_t layer, uint64_t bytes){
+        if(!m_ring){
+            uint32_t p = layer % m_streams.size();
+            if(m_transferStart[p] == Time::Max()){
+                m_transferStart[p] = Simulator::Now();
+            }
+            if(m_scheduled){
+                m_ready[p][layer] += bytes;
+                SendNext(p);
+                return;
+            }
+            MarkSend();
+            m_streams[p].Push(bytes);
+            return;
+        }
+        m_bucket += bytes;
+        if(m_bucket >= m_bucketSize){
+            CloseBucket();
+        }
+    }
+
+    // Appends the all-reduce steps of the current bucket.
+    void CloseBucket(){
+        if(m_bucket == 0 || m_ringSize < 2){
+            m_bucket = 0;
+            return;
+        }
+        uint64_t chunk = (m_bucket + m_ringSize - 1) / m_ringSize;
+        for(uint32_t s = 0; s < 2 * (m_ringSize - 1); s++){
+            m_stepFirst.push_back(s == 0);
+            m_stepPrefix.push_back(m_stepTotal);
+            m_steps.push_back(chunk);
+            m_stepTotal += chunk;
+        }
+        m_bucketStart.push_back(Simulator::Now());
+        m_bucketEnd.push_back(m_stepTotal);
+        m_bucketBytes.push_back(m_bucket);
+        m_bucket = 0;
+        SendSteps();
+    }
+
+    // A step goes out once the previous worker's chunk of the step before
+    // it has arrived; the first step of a bucket only needs the bucket.
+    void SendSteps(){
+        while(m_nextStep < m_steps.size() && (m_stepFirst[m_nextStep] || m_rx[0] >= m_stepPrefix[m_nextStep])){
+            MarkSend();
+            m_streams[0].Push(m_steps[m_nextStep]);
+            m_nextStep++;
+        }
+    }
+
+    // Scheduled pushes: one chunk at a time per PS, asking for a token first
+    // when the PS coordinates the workers.
+    void SendNext(uint32_t p){
+        if(!m_running || m_sending[p] || m_ready[p].empty()){
+            return;
+        }
+        m_sending[p] = true;
+        if(m_layerWise){
+            m_coordinators[p]->Request(m_index);
+        }else{
+            PushChunk(p);
+        }
+    }
+
+    // Pushes the chunk of the first ready layer.
+    void PushChunk(uint32_t p){
+        auto it = m_ready[p].begin();
+        uint32_t layer = it->first;
+        uint64_t bytes = m_chunkSize > 0 ? std::min<uint64_t>(m_chunkSize, it->second) : it->second;
+        it->second -= bytes;
+        if(it->second == 0){
+            m_ready[p].erase(it);
+        }
+        MarkSend();
+        if(m_layerWise){
+            m_coordinators[p]->Sent(m_index, layer, bytes);
+        }
+        m_streams[p].Push(bytes);
+    }
+
+    void LayerUpdated(uint32_t layer){
+        m_updated[layer] = true;
+        m_updatesLeft--;
+        uint32_t p = layer % m_streams.size();
+        m_shardLeft[p] -= m_model.layerBytes[layer];
+        if(m_shardLeft[p] == 0 && !m_transferDone[p]){
+            m_transferDone[p] = true;
+            m_transferTrace(p, m_transferStart[p], Simulator::Now(), m_shardBytes[p]);
+        }
+    }
+
+    // Forward pass of the next iteration, one layer at a time, each layer
+    // starting once its update is back.
+    void Forward(){
+        uint32_t layers = m_model.layerBytes.size();
+        if(m_forwardLayer >= layers || m_forwardEvent.IsPending() || !m_updated[m_forwardLayer]){
+            return;
+        }
+        if(m_forwardLayer == 0){
+            m_forwardStart = Simulator::Now();
+        }
+        Time step = Seconds(m_computeTime.GetSeconds() * m_forwardFraction / layers);
+        m_forwardEvent = Simulator::Schedule(step, &DdlWorkerApp::ForwardLayerDone, this);
+    }
+
+    void ForwardLayerDone(){
+        if(++m_forwardLayer < m_model.layerBytes.size()){
+            Forward();
+            return;
+        }
+        // Every update has arrived, so the previous iteration is reported;
+        // the new one counts from when the previous one's communication
+        // ended, as without overlap
+        ResetIteration(std::max(m_forwardStart, m_commEnd));
+        m_layer = m_model.layerBytes.size();
+        BackwardLayer();
+    }
+
+    void MarkSend(){
+        if(m_firstSend == Time::Max()){
+            m_firstSend = Simulator::Now();
+        }
+    }
+
+    void Receive(uint32_t peer, Ptr<Socket> socket){
+        Ptr<Packet> packet;
+        Address from;
+        uint64_t bytes = 0;
+        while((packet = socket->RecvFrom(from))){
+            bytes += packet->GetSize();
+            m_peerRxTrace(peer, packet, from);
+        }
+        if(m_layerWise){
+            m_coordinators[peer]->ReplyReceived(m_index, bytes);
+            CheckDone();
+            Forward();
+            return;
+        }
+        m_rx[peer] += bytes;
+        ReportTransfers(peer);
+        if(m_ring){
+            SendSteps();
+        }
+        CheckDone();
+    }
+
+    void ReportTransfers(uint32_t peer){
+        Time now = Simulator::Now();
+        if(m_ring){
+            while(m_nextBucket < m_bucketEnd.size() && m_rx[0] >= m_bucketEnd[m_nextBucket]){
+                m_transferTrace(0, m_bucketStart[m_nextBucket], now, m_bucketBytes[m_nextBucket]);
+                m_nextBucket++;
+            }
+        }else if(!m_transferDone[peer] && m_shardBytes[peer] > 0 && m_rx[peer] >= m_shardBytes[peer]){
+            m_transferDone[peer] = true;
+            m_transferTrace(peer, m_transferStart[peer], now, m_shardBytes[peer]);
+        }
+    }
+
+    bool CommDone() const{
+        if(m_layerWise){
+            return m_updatesLeft == 0;
+        }
+        if(m_ring){
+            return m_nextStep == m_steps.size() && m_rx[0] >= m_stepTotal;
+        }
+        for(uint32_t p = 0; p < m_rx.size(); p++){
+            if(m_rx[p] < m_shardBytes[p]){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void CheckDone(){
+        if(!m_computeDone || !CommDone()){
+            return;
+        }
+        Time now = Simulator::Now();
+        m_iterationTrace(m_done, m_start, m_firstSend == Time::Max() ? m_computeEnd : m_firstSend, m_computeEnd, now);
+        m_commEnd = now;
+        if(m_layerWise){
+            // The next forward pass is already waiting on the updates
+            m_computeDone = false;
+            m_done++;
+            return;
+        }
+        // Bytes beyond this iteration already belong to the next one
+        if(m_ring){
+            m_rx[0] -= m_stepTotal;
+        }else{
+            for(uint32_t p = 0; p < m_rx.size(); p++){
+                m_rx[p] -= m_shardBytes[p];
+            }
+        }
+        m_computeDone = false;
+        if(++m_done < m_iterations || m_iterations == 0){
+            StartIteration();
+        }
+    }
+
+    ModelProfile m_model;
+    Time m_computeTime;
+    double m_forwardFraction;
+    uint32_t m_iterations;
+    uint32_t m_bucketSize;
+    uint16_t m_port;
+    uint32_t m_chunkSize;
+    uint8_t m_tos;
+    DataRate m_rate;
+    bool m_ring = false;
+    uint32_t m_ringSize = 1;
+    std::vector<Ipv4Address> m_peers;
+    std::vector<GradientStream> m_streams;
+    Ptr<Socket> m_listener;
+    Ptr<Socket> m_inbound;
+    std::vector<uint64_t> m_rx;
+    std::vector<uint64_t> m_shardBytes;
+    EventId m_event;
+    uint32_t m_done = 0;
+    uint32_t m_layer = 0;
+    bool m_computeDone = false;
+    Time m_start;
+    Time m_firstSend;
+    Time m_computeEnd;
+    uint64_t m_bucket = 0;
+    std::vector<uint64_t> m_steps;
+    std::vector<uint64_t> m_stepPrefix;
+    std::vector<bool> m_stepFirst;
+    uint32_t m_nextStep = 0;
+    uint64_t m_stepTotal = 0;
+    std::vector<Time> m_transferStart;
+    std::vector<bool> m_transferDone;
+    std::vector<Time> m_bucketStart;
+    std::vector<uint64_t> m_bucketEnd;
+    std::vector<uint64_t> m_bucketBytes;
+    uint32_t m_nextBucket = 0;
+    bool m_running = false;
+    bool m_scheduled = false;
+    bool m_layerWise = false;
+    uint32_t m_index = 0;
+    std::vector<Ptr<DdlPushCoordinator>> m_coordinators;
+    std::vector<std::map<uint32_t, uint64_t>> m_ready;      // per PS: layer -> bytes not pushed yet
+    std::vector<bool> m_sending;
+    std::vector<bool> m_updated;
+    uint32_t m_updatesLeft = 0;
+    std::vector<uint64_t> m_shardLeft;
+    uint32_t m_forwardLayer = 0;
+    Time m_forwardStart;
+    Time m_commEnd;
+    EventId m_forwardEvent;
+    TracedCallback<uint32_t, Time, Time, Time, Time> m_iterationTrace;
+    TracedCallback<uint32_t, Ptr<const Packet>, const Address&> m_peerRxTrace;
+    TracedCallback<uint32_t, Time, Time, uint64_t> m_transferTrace;
+};
+
+// Synchronous parameter server for one shard: once every worker has pushed
+// the shard for an iteration, the updated shard is sent back to all of them.
+// With a coordinator each layer of the shard is sent back as soon as every
+// worker has pushed that layer.
+class DdlPsApp : public Application {
+public:
+    static TypeId GetTypeId(){
+        static TypeId tid = TypeId("ns3::DdlPsApp")
+            .SetParent<Application>()
+            .SetGroupName("Applications")
+            .AddConstructor<DdlPsApp>()
+            .AddAttribute("Port", "Listening port",
+                          UintegerValue(5000),
+                          MakeUintegerAccessor(&DdlPsApp::m_port),
+                          MakeUintegerChecker<uint16_t>())
+            .AddAttribute("Tos", "IP TOS of the training sockets",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&DdlPsApp::m_tos),
+                          MakeUintegerChecker<uint8_t>())
+            .AddTraceSource("PeerRx", "Gradient data received from a worker",
+                            MakeTraceSourceAccessor(&DdlPsApp::m_peerRxTrace),
+                            "ns3::DdlPsApp::PeerRxTracedCallback");
+        return tid;
+    }
+
+    void SetWorkers(const std::vector<Ipv4Address>& workers){
+        m_workers = workers;
+    }
+
+    void SetShardBytes(uint64_t bytes){
+        m_shardBytes = bytes;
+    }
+
+    // Per-layer replies through coordinator; layers maps each layer of the
+    // shard to its size.
+    void SetCoordinator(Ptr<DdlPushCoordinator> coordinator, const std::map<uint32_t, uint64_t>& layers){
+        m_coordinator = coordinator;
+        m_layerBytes = layers;
+    }
+
+protected:
+    void DoDispose() override{
+        m_streams.clear();
+        m_coordinator = nullptr;
+        m_listener = nullptr;
+        Application::DoDispose();
+    }
+
+private:
+    void StartApplication() override{
+        m_streams.resize(m_workers.size());
+        m_rx.assign(m_workers.size(), 0);
+        if(m_coordinator){
+            m_coordinator->SetChunkCallback(MakeCallback(&DdlPsApp::ChunkReceived, this));
+        }
+        m_listener = Socket::CreateSocket(GetNode(), TcpSocketFactory::GetTypeId());
+        m_listener->SetIpTos(m_tos);
+        m_listener->Bind(InetSocketAddress(Ipv4Address::GetAny(), m_port));
+        m_listener->Listen();
+        m_listener->SetAcceptCallback(MakeNullCallback<bool, Ptr<Socket>, const Address&>(),
+                                      MakeCallback(&DdlPsApp::Accept, this));
+    }
+
+    void StopApplication() override{
+        for(GradientStream& stream : m_streams){
+            stream.Close();
+        }
+        if(m_listener){
+            m_listener->Close();
+        }
+    }
+
+    void Accept(Ptr<Socket> socket, const Address& from){
+        Ipv4Address address = InetSocketAddress::ConvertFrom(from).GetIpv4();
+        auto it = std::find(m_workers.begin(), m_workers.end(), address);
+        if(it == m_workers.end()){
+            socket->Close();
+            return;
+        }
+        uint32_t worker = it - m_workers.begin();
+        socket->SetIpTos(m_tos);
+        m_streams[worker].Attach(socket);
+        socket->SetRecvCallback(Callback<void, Ptr<Socket>>([this, worker](Ptr<Socket> s){
+            Receive(worker, s);
+        }));
+    }
+
+    void Receive(uint32_t worker, Ptr<Socket> socket){
+        Ptr<Packet> packet;
+        Address from;
+        uint64_t bytes = 0;
+        while((packet = socket->RecvFrom(from))){
+            bytes += packet->GetSize();
+            m_peerRxTrace(worker, packet, from);
+        }
+        if(m_coordinator){
+            m_coordinator->Received(worker, bytes);
+            return;
+        }
+        m_rx[worker] += bytes;
+        for(uint64_t rx : m_rx){
+            if(rx < m_shardBytes){
+                return;
+            }
+        }
+        for(uint32_t w = 0; w < m_workers.size(); w++){
+            m_rx[w] -= m_shardBytes;
+            m_streams[w].Push(m_shardBytes);
+        }
+    }
+
+    void ChunkReceived(uint32_t worker, uint32_t layer, uint64_t bytes){
+        uint64_t& rx = m_layerRx[layer];
+        rx += bytes;
+        uint64_t size = m_layerBytes[layer];
+        if(rx < size * m_workers.size()){
+            return;
+        }
+        rx -= size * m_workers.size();
+        m_coordinator->Replied(layer, size);
+        for(GradientStream& stream : m_streams){
+            stream.Push(size);
+        }
+    }
+
+    uint16_t m_port;
+    uint8_t m_tos;
+    Ptr<DdlPushCoordinator> m_coordinator;
+    std::map<uint32_t, uint64_t> m_layerBytes;
+    std::map<uint32_t, uint64_t> m_layerRx;
+    std::vector<Ipv4Address> m_workers;
+    uint64_t m_shardBytes = 0;
+    Ptr<Socket> m_listener;
+    std::vector<GradientStream> m_streams;
+    std::vector<uint64_t> m_rx;
+    TracedCallback<uint32_t, Ptr<const Packet>, const Address&> m_peerRxTrace;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(DdlPushCoordinator);
+NS_OBJECT_ENSURE_REGISTERED(DdlWorkerApp);
+NS_OBJECT_ENSURE_REGISTERED(DdlPsApp);
+
+} // namespace ns3
+
+#endif
@@ -0,0 +1,242 @@
+import argparse
+import json
+import os
+import platform
+import sys
+
+import tracereader
+from sweep import find_trace, flow_throughput, run_point
+
+# Regression benchmark for the DDL-Congestion scenarios.
+#
+# Runs the canonical cubic and ecn scenarios with a fixed seed and compares
+# their queue and throughput statistics against the reference traces in
+# Results/, then compares wall time, event count and event rate of every
+# benchmark (including a scaled-up fat-tree with 64 workers, whose reference
+# statistics live in the performance baseline) against
+# Results/perf_baseline.json. Every check is printed as a row of the diff
+# table; any failure makes the script exit with status 1.
+#
+# The Results/ throughput comes from FlowMonitor, which counts IP bytes
+# (1500 byte packets with headers), while the current traces count the
+# payload the sinks receive (1448 bytes per segment). Reference throughput is
+# therefore scaled by 1448/1500 before comparing, so the tolerance is not
+# eaten by the ~3.5% header overhead.
+#
+# --update-baseline stores the current performance numbers (and the scaled
+# benchmark's statistics) as the new baseline. It refuses when a run or a
+# statistics check failed, so a regression is not recorded as the baseline,
+# unless --force is given. No baseline is checked in. A missing baseline, or a
+# benchmark without reference statistics, fails the run unless
+# --update-baseline is given; --no-perf skips only the performance checks.
+# Performance depends on the machine, so record the baseline on the machine
+# the benchmark runs on.
+
+ROOT = os.path.dirname(os.path.abspath(__file__))
+RESULTS = os.path.join(ROOT, "Results")
+PERF_BASELINE = os.path.join(RESULTS, "perf_baseline.json")
+
+BENCHMARKS = {
+    "cubic": {"params": {"variant": "cubic", "RngRun": 1}, "reference": os.path.join(RESULTS, "Cubic")},
+    "ecn": {"params": {"variant": "ecn", "RngRun": 1}, "reference": os.path.join(RESULTS, "ECN")},
+    "scaled": {"params": {"variant": "ecn", "RngRun": 1, "topology": "fattree", "k": 8, "workers": 64, "ps": 4,
+                          "routing": "fabric", "sender": "paced", "simTime": 5}, "reference": None},
+}
+
+# metric prefix -> (relative tolerance, absolute tolerance)
+TOLERANCES = {
+    "queue": (0.25, 5.0),        # packets
+    "total_mbps": (0.05, 5.0),
+    "flow_mbps": (0.20, 10.0),
+}
+# Payload bytes per IP byte of a full segment (default 1448 byte MSS)
+PAYLOAD_SHARE = 1448.0 / 1500.0
+# Performance: slower/faster by this share fails; events are deterministic
+PERF_TOLERANCE = 0.25
+EVENT_TOLERANCE = 0.02
+
+
+def percentile(values, q):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(q * len(values)))]
+
+
+def trace_stats(run_dir, ip_bytes=False):
+    # Statistics that the old polled traces in Results/ and the new event
+    # driven summaries have in common: the sampled QueueSize column and the
+    # per-flow throughput of the data flows. ip_bytes: the throughput trace
+    # counts IP bytes (FlowMonitor), convert it to payload.
+    stats = {}
+    for name in ("q1", "q2"):
+        path = find_trace(run_dir, "%sSize" % name)
+        if path:
+            sizes = [float(row[1]) for row in tracereader.read_rows(path)]
+            stats["queue_%s_mean" % name] = sum(sizes) / len(sizes) if sizes else 0.0
+            stats["queue_%s_p90" % name] = percentile(sizes, 0.9)
+            stats["queue_%s_max" % name] = max(sizes) if sizes else 0.0
+    flows = flow_throughput(run_dir)
+    if ip_bytes:
+        flows = {key: mbps * PAYLOAD_SHARE for key, mbps in flows.items()}
+    if flows:
+        stats["total_mbps"] = sum(flows.values())
+        for key, mbps in flows.items():
+            stats[key.replace("flow", "flow_mbps", 1)] = mbps
+    return stats
+
+
+def read_report(run_dir):
+    for name in sorted(os.listdir(run_dir)):
+        if name.startswith("run_report") and name.endswith(".json"):
+            with open(os.path.join(run_dir, name)) as f:
+                return json.load(f)
+    return {}
+
+
+def check(rows, name, metric, expected, actual, rel, tol_abs):
+    delta = actual - expected
+    allowed = max(rel * abs(expected), tol_abs)
+    ok = abs(delta) <= allowed
+    rows.append((name, metric, expected, actual, delta, allowed, "ok" if ok else "FAIL"))
+    return ok
+
+
+def tolerance(metric, scale):
+    for prefix, (rel, tol_abs) in TOLERANCES.items():
+        if metric.startswith(prefix):
+            return rel * scale, tol_abs * scale
+    return 0.1 * scale, 0.0
+
+
+def compare_stats(rows, name, reference, current, scale):
+    ok = True
+    for metric in sorted(reference):
+        expected = reference[metric]
+        if metric.startswith("flow_mbps") and expected < 1.0:
+            continue
+        if metric not in current:
+            rows.append((name, metric, expected, float("nan"), float("nan"), 0.0, "MISSING"))
+            ok = False
+            continue
+        rel, tol_abs = tolerance(metric, scale)
+        ok &= check(rows, name, metric, expected, current[metric], rel, tol_abs)
+    return ok
+
+
+def compare_perf(rows, name, baseline, report, perf_tolerance):
+    ok = True
+    wall = report.get("run_wall_seconds", 0.0)
+    rate = report.get("events_per_wall_second", 0.0)
+    events = report.get("events", 0)
+    if "wall_s" in baseline:
+        # Only slowdowns fail; a faster run is reported but passes
+        limit = baseline["wall_s"] * (1 + perf_tolerance)
+        good = wall <= limit
+        rows.append((name, "perf wall_s", baseline["wall_s"], wall, wall - baseline["wall_s"], limit - baseline["wall_s"], "ok" if good else "FAIL"))
+        ok &= good
+    if "events_per_s" in baseline:
+        limit = baseline["events_per_s"] * (1 - perf_tolerance)
+        good = rate >= limit
+        rows.append((name, "perf events_per_s", baseline["events_per_s"], rate, rate - baseline["events_per_s"], baseline["events_per_s"] - limit, "ok" if good else "FAIL"))
+        ok &= good
+    if "events" in baseline:
+        ok &= check(rows, name, "perf events", baseline["events"], events, EVENT_TOLERANCE, 0)
+    return ok
+
+
+def print_table(rows):
+    print("%-8s %-40s %14s %14s %12s %12s  %s" % ("bench", "metric", "baseline", "current", "delta", "allowed", "status"))
+    for name, metric, expected, actual, delta, allowed, status in rows:
+        print("%-8s %-40s %14.3f %14.3f %+12.3f %12.3f  %s" % (name, metric, expected, actual, delta, allowed, status))
+
+
+def machine():
+    return {"platform": platform.platform(), "processor": platform.processor(), "cpus": os.cpu_count(), "python": platform.python_version()}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Check DDL-Congestion results and simulator speed against the stored baselines")
+    parser.add_argument("--ns3-dir", required=True, help="ns-3 source tree the program was built in")
+    parser.add_argument("--only", default=",".join(BENCHMARKS), help="comma separated benchmarks (%s)" % ", ".join(BENCHMARKS))
+    parser.add_argument("--out", default="benchmark_out", help="output directory")
+    parser.add_argument("--tolerance-scale", type=float, default=1.0, help="scale every statistics tolerance")
+    parser.add_argument("--perf-tolerance", type=float, default=PERF_TOLERANCE, help="allowed wall time / event rate regression")
+    parser.add_argument("--update-baseline", action="store_true", help="store this run as the performance baseline")
+    parser.add_argument("--force", action="store_true", help="with --update-baseline, write it even if a run or statistics check failed")
+    parser.add_argument("--no-perf", action="store_true", help="skip the performance checks (a missing baseline is then not a failure)")
+    parser.add_argument("--timeout", type=float, default=None, help="per-run timeout in seconds")
+    args = parser.parse_args()
+
+    names = [n for n in args.only.split(",") if n]
+    for name in names:
+        if name not in BENCHMARKS:
+            sys.exit("Unknown benchmark %s, expected one of %s" % (name, ", ".join(BENCHMARKS)))
+
+    baseline = {}
+    rows = []
+    ok = True
+    # Runs and statistics checks only; performance is what a new baseline resets
+    stats_ok = True
+    if os.path.exists(PERF_BASELINE):
+        with open(PERF_BASELINE) as f:
+            baseline = json.load(f)
+    elif not args.update_baseline and not args.no_perf:
+        print("No performance baseline at %s (record it with --update-baseline, or skip the performance checks with --no-perf)" % PERF_BASELINE)
+        rows.append(("-", "perf baseline missing", 0.0, 0.0, 0.0, 0.0, "FAIL"))
+        ok = False
+    updated = {"machine": machine(), "benchmarks": dict(baseline.get("benchmarks", {}))}
+    # Sequential, so the wall times are not skewed by concurrent runs
+    for name in names:
+        bench = BENCHMARKS[name]
+        run_dir = os.path.join(args.out, name)
+        status, wall = run_point(args.ns3_dir, bench["params"], run_dir, args.timeout)
+        print("%s: %s (%.1f s)" % (name, status, wall), flush=True)
+        if status != "ok":
+            rows.append((name, "run " + status, 0.0, 0.0, 0.0, 0.0, "FAIL"))
+            ok = stats_ok = False
+            continue
+        current = trace_stats(run_dir)
+        report = read_report(run_dir)
+        stored = baseline.get("benchmarks", {}).get(name, {})
+        if bench["reference"]:
+            stats_ok &= compare_stats(rows, name, trace_stats(bench["reference"], ip_bytes=True), current, args.tolerance_scale)
+        elif stored.get("stats"):
+            stats_ok &= compare_stats(rows, name, stored["stats"], current, args.tolerance_scale)
+        elif not args.update_baseline:
+            print("%s: no reference statistics, record them with --update-baseline" % name)
+            rows.append((name, "reference stats missing", 0.0, 0.0, 0.0, 0.0, "FAIL"))
+            ok = False
+        ok &= stats_ok
+        if not args.no_perf:
+            if stored:
+                ok &= compare_perf(rows, name, stored, report, args.perf_tolerance)
+            elif baseline and not args.update_baseline:
+                print("%s: not in the performance baseline, record it with --update-baseline" % name)
+                rows.append((name, "perf baseline missing", 0.0, 0.0, 0.0, 0.0, "FAIL"))
+                ok = False
+        updated["benchmarks"][name] = {
+            "params": bench["params"],
+            "wall_s": report.get("run_wall_seconds", wall),
+            "events": report.get("events", 0),
+            "events_per_s": report.get("events_per_wall_second", 0.0),
+            "peak_rss_kb": report.get("peak_rss_kb", 0),
+            "stats": current if not bench["reference"] else {},
+        }
+
+    print()
+    print_table(rows)
+    if args.update_baseline and not stats_ok and not args.force:
+        print("Baseline not written: a run or statistics check failed (use --force to record it anyway)")
+        ok = False
+    elif args.update_baseline:
+        with open(PERF_BASELINE, "w") as f:
+            json.dump(updated, f, indent=2, sort_keys=True)
+        print("Baseline written to %s" % PERF_BASELINE)
+    failures = sum(1 for row in rows if row[-1] != "ok")
+    print("%d checks, %d failed" % (len(rows), failures))
+    sys.exit(0 if ok else 1)
+
+
+if __name__ == "__main__":
+    main()
@@ -1,13 +1,15 @@
 import os
 import numpy as np
 import matplotlib.pyplot as plt
+from tracereader import read_rows
 
 # Get the data from the Results folder
 path = 'Results/ECN'
 
 # q1Size.csv and q2Size.csv
-q1Size = np.genfromtxt(os.path.join(path, 'q1Size_ECN.csv'), delimiter=',')
-q2Size = np.genfromtxt(os.path.join(path, 'q2Size_ECN.csv'), delimiter=',')
+# read_rows also reads the binary .ddlt traces of --traceFormat=binary
+q1Size = np.array(read_rows(os.path.join(path, 'q1Size_ECN.csv')), dtype=float)
+q2Size = np.array(read_rows(os.path.join(path, 'q2Size_ECN.csv')), dtype=float)
 
 plt.figure(figsize=(10, 5))
 plt.plot(q1Size[:, 0], q1Size[:, 1], label='Queue 1 Size', color='blue', linewidth=1.5)
@@ -21,7 +23,7 @@ plt.savefig(path + 'queue_sizes.png')
 plt.close()  # Close the figure after saving to avoid overlap
 
 # throughput.csv
-throughput = np.genfromtxt(os.path.join(path, 'throughput_ECN.csv'), delimiter=',', dtype=str)
+throughput = read_rows(os.path.join(path, 'throughput_ECN.csv'))
 flows = {
     "Flow 1": {"src_ip": "192.168.1.2", "data": {}, "color": "blue", "label": "Main Flow 1"},
     "Flow 2": {"src_ip": "192.168.2.2", "data": {}, "color": "orange", "label": "Main Flow 2"},
@@ -34,8 +36,7 @@ flows = {
 }
 
 # Organize throughput data per flow
-# Skip the first row
-for row in throughput[1:]:
+for row in throughput:
     time, src_ip, dst_ip, throughput_value = float(row[0]), row[1], row[3], float(row[5])
     for flow_name, flow_info in flows.items():
         if flow_info["src_ip"] == src_ip and flow_info.get("dst_ip", dst_ip) == dst_ip:
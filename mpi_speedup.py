@@ -0,0 +1,56 @@
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+from sweep import PROGRAM, VARIANTS, find_binary, summarize_run
+
+# Runs one configuration sequentially and distributed over local MPI ranks
+# with the same seed, and reports the speedup of Simulator::Run() together
+# with the summary statistics of both runs.
+
+
+def simulate(args, out_dir):
+    os.makedirs(out_dir, exist_ok=True)
+    with open(os.path.join(out_dir, "run.log"), "w") as log:
+        log.write(" ".join(args) + "\n")
+        log.flush()
+        proc = subprocess.run(args, cwd=out_dir, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+        log.write(proc.stdout)
+    if proc.returncode != 0:
+        sys.exit("%s failed, see %s" % (" ".join(args), os.path.join(out_dir, "run.log")))
+    match = re.search(r"Simulation wall time ([0-9.eE+-]+) s", proc.stdout)
+    if not match:
+        sys.exit("No wall time reported by %s" % args[0])
+    return float(match.group(1))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare a distributed run against the sequential run for the same seed")
+    parser.add_argument("--ns3-dir", required=True, help="ns-3 source tree built with --enable-mpi")
+    parser.add_argument("--variant", default="cubic", choices=sorted(VARIANTS))
+    parser.add_argument("--np", type=int, default=2, help="number of MPI ranks")
+    parser.add_argument("--mpirun", default="mpirun")
+    parser.add_argument("--out", default="mpi_out")
+    parser.add_argument("flags", nargs="*", help="extra program flags, e.g. --topology=fattree --k=8")
+    args = parser.parse_args()
+
+    binary = find_binary(args.ns3_dir, PROGRAM)
+    flags = ["--scenario=" + VARIANTS[args.variant]] + (args.flags or [])
+    seq_dir = os.path.abspath(os.path.join(args.out, "sequential"))
+    mpi_dir = os.path.abspath(os.path.join(args.out, "mpi%d" % args.np))
+
+    sequential = simulate([binary, "--outDir=" + seq_dir] + flags, seq_dir)
+    distributed = simulate([args.mpirun, "-np", str(args.np), binary, "--distributed", "--outDir=" + mpi_dir] + flags, mpi_dir)
+
+    print("sequential  %8.2f s" % sequential)
+    print("%d ranks     %8.2f s   speedup %.2fx" % (args.np, distributed, sequential / max(distributed, 1e-9)))
+    seq_summary = summarize_run(seq_dir)
+    mpi_summary = summarize_run(mpi_dir)
+    for key in sorted(seq_summary):
+        print("%-12s %10.3f %10.3f" % (key, seq_summary[key], mpi_summary.get(key, float("nan"))))
+
+
+if __name__ == "__main__":
+    main()
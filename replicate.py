@@ -0,0 +1,186 @@
+import argparse
+import math
+import os
+import sys
+import time
+from concurrent.futures import FIRST_COMPLETED, ThreadPoolExecutor, wait
+
+from sweep import VARIANTS, flow_throughput, parse_value, run_point, summarize_run, write_summary
+
+# Independent replications of one DDL-Congestion configuration.
+#
+# Replication i runs with --RngRun=<first-run>+i, so each one draws an
+# independent ns-3 random stream (the background on/off times) and every
+# replication can be reproduced on its own. Runs execute in parallel on
+# --jobs workers. Once --min-runs replications have finished, a t-based
+# confidence interval is computed for every target metric after each
+# completed run, and no further runs are started once all of them have a
+# half-width within --target of their mean (or --max-runs is reached). Runs
+# already in flight still finish and are included.
+#
+# Output in --out: replications.csv (one row of metrics per run) and
+# confidence.csv (metric, n, mean, std, CI bounds, relative half-width) for
+# every metric, the queue statistics, run report numbers and the per-flow
+# throughput included. A flow that carried no data in a run has no throughput
+# row and counts as 0 Mbps in that run. Target metrics that the first
+# completed run does not report are an error.
+
+# Two-sided Student t critical values for 1..30 degrees of freedom
+T_TABLE = {
+    0.90: [6.314, 2.920, 2.353, 2.132, 2.015, 1.943, 1.895, 1.860, 1.833, 1.812,
+           1.796, 1.782, 1.771, 1.761, 1.753, 1.746, 1.740, 1.734, 1.729, 1.725,
+           1.721, 1.717, 1.714, 1.711, 1.708, 1.706, 1.703, 1.701, 1.699, 1.697],
+    0.95: [12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+           2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+           2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042],
+    0.99: [63.657, 9.925, 5.841, 4.604, 4.032, 3.707, 3.499, 3.355, 3.250, 3.169,
+           3.106, 3.055, 3.012, 2.977, 2.947, 2.921, 2.898, 2.878, 2.861, 2.845,
+           2.831, 2.819, 2.807, 2.797, 2.787, 2.779, 2.771, 2.763, 2.756, 2.750],
+}
+# Normal quantiles beyond 30 degrees of freedom
+Z = {0.90: 1.645, 0.95: 1.960, 0.99: 2.576}
+
+
+def t_critical(confidence, df):
+    return T_TABLE[confidence][df - 1] if df <= 30 else Z[confidence]
+
+
+def interval(values, confidence):
+    # (n, mean, std, half-width) of the t confidence interval of the mean
+    n = len(values)
+    mean = sum(values) / n
+    if n < 2:
+        return n, mean, 0.0, float("inf")
+    std = math.sqrt(sum((v - mean) ** 2 for v in values) / (n - 1))
+    return n, mean, std, t_critical(confidence, n - 1) * std / math.sqrt(n)
+
+
+def relative(mean, half):
+    if half == 0:
+        return 0.0
+    return half / abs(mean) if mean else float("inf")
+
+
+def collect(run_dir):
+    metrics = summarize_run(run_dir)
+    metrics.update(flow_throughput(run_dir))
+    return {k: v for k, v in metrics.items() if isinstance(v, (int, float))}
+
+
+def values_of(records, metric):
+    if metric.startswith("flow "):
+        return [r.get(metric, 0.0) for r in records]
+    return [r[metric] for r in records if metric in r]
+
+
+def converged(records, metrics, confidence, target):
+    for metric in metrics:
+        values = values_of(records, metric)
+        if len(values) < 2:
+            return False
+        n, mean, std, half = interval(values, confidence)
+        if relative(mean, half) > target:
+            return False
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Run independent replications of one DDL-Congestion configuration until the confidence intervals are narrow enough")
+    parser.add_argument("--ns3-dir", required=True, help="ns-3 source tree the program was built in")
+    parser.add_argument("--variant", default="cubic", choices=sorted(VARIANTS), help="scenario to replicate")
+    parser.add_argument("-p", "--param", action="append", default=[], help="flag=value passed to every run (repeatable)")
+    parser.add_argument("--out", default="replicate_out", help="output directory")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count(), help="parallel runs (default: all cores)")
+    parser.add_argument("--first-run", type=int, default=1, help="RngRun of the first replication")
+    parser.add_argument("--min-runs", type=int, default=3, help="replications before the first convergence check")
+    parser.add_argument("--max-runs", type=int, default=30, help="upper bound on replications")
+    parser.add_argument("--confidence", type=float, default=0.95, choices=sorted(T_TABLE), help="confidence level")
+    parser.add_argument("--target", type=float, default=0.05, help="stop once every target metric's CI half-width is within this share of its mean")
+    parser.add_argument("--metrics", default="total_mbps,q1_mean", help="comma separated target metrics (columns of replications.csv)")
+    parser.add_argument("--timeout", type=float, default=None, help="per-run timeout in seconds")
+    args = parser.parse_args()
+
+    params = {"variant": args.variant}
+    for param in args.param:
+        key, _, value = param.partition("=")
+        if key in ("RngRun", "variant"):
+            sys.exit("%s is set by replicate.py (use --first-run / --variant)" % key)
+        params[key] = parse_value(value)
+    metrics = [m for m in args.metrics.split(",") if m]
+    min_runs = max(2, args.min_runs)
+    os.makedirs(args.out, exist_ok=True)
+
+    records = []
+    unknown = []
+    failed = 0
+    submitted = 0
+    start = time.time()
+    with ThreadPoolExecutor(max_workers=args.jobs) as pool:
+        running = {}
+
+        def submit():
+            nonlocal submitted
+            run = args.first_run + submitted
+            run_dir = os.path.join(args.out, "rep%03d_RngRun-%d" % (submitted, run))
+            point = dict(params, RngRun=run)
+            running[pool.submit(run_point, args.ns3_dir, point, run_dir, args.timeout)] = (run, run_dir)
+            submitted += 1
+
+        stop = False
+        while len(running) < args.jobs and submitted < args.max_runs:
+            submit()
+        while running:
+            done, _ = wait(running, return_when=FIRST_COMPLETED)
+            for future in done:
+                run, run_dir = running.pop(future)
+                status, wall = future.result()
+                if status == "ok":
+                    record = {"RngRun": run, "wall_s": round(wall, 2)}
+                    record.update(collect(run_dir))
+                    records.append(record)
+                    if len(records) == 1:
+                        unknown = [m for m in metrics if m not in record]
+                        if unknown:
+                            # Would never converge; let the runs in flight finish
+                            stop = True
+                            print("Unknown target metrics %s, stopping" % ", ".join(unknown), flush=True)
+                else:
+                    failed += 1
+                print("[%d] RngRun=%d %s (%.1f s)" % (len(records) + failed, run, status, wall), flush=True)
+            if not stop and len(records) >= min_runs and converged(records, metrics, args.confidence, args.target):
+                stop = True
+                print("Target CI width reached after %d replications" % len(records), flush=True)
+            while not stop and len(running) < args.jobs and submitted < args.max_runs:
+                submit()
+
+    if not records:
+        sys.exit("No replication finished")
+    if unknown:
+        sys.exit("Unknown target metrics %s, expected columns of replications.csv: %s" % (", ".join(unknown), ", ".join(k for k in records[0] if k not in ("RngRun", "wall_s"))))
+    records.sort(key=lambda r: r["RngRun"])
+    keys = []
+    for record in records:
+        keys += [k for k in record if k not in keys and k not in ("RngRun", "wall_s")]
+    for record in records:
+        for key in keys:
+            if key.startswith("flow "):
+                record.setdefault(key, 0.0)
+    write_summary(os.path.join(args.out, "replications.csv"), records)
+
+    rows = []
+    print("%-40s %4s %14s %12s %14s %14s %8s" % ("metric", "n", "mean", "std", "ci_low", "ci_high", "rel"))
+    for key in keys:
+        values = values_of(records, key)
+        n, mean, std, half = interval(values, args.confidence)
+        rel = relative(mean, half)
+        rows.append({"metric": key, "n": n, "mean": mean, "std": std, "ci_low": mean - half, "ci_high": mean + half,
+                     "half_width": half, "rel_half_width": rel, "target": key in metrics})
+        print("%-40s %4d %14.3f %12.3f %14.3f %14.3f %8.3f%s" % (key, n, mean, std, mean - half, mean + half, rel, " *" if key in metrics else ""))
+    write_summary(os.path.join(args.out, "confidence.csv"), rows)
+    print("%d replications (%d failed) in %.1f s, %d%% confidence, * = target metric" % (len(records), failed, time.time() - start, args.confidence * 100))
+    if not converged(records, metrics, args.confidence, args.target):
+        print("Target CI width %.3f not reached within %d replications" % (args.target, args.max_runs))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,309 @@
+import argparse
+import csv
+import glob
+import itertools
+import json
+import math
+import os
+import subprocess
+import sys
+import time
+from concurrent.futures import ThreadPoolExecutor, as_completed
+
+import tracereader
+
+# Parameter sweep over the DDL-Congestion scenario engine.
+#
+# Every grid point runs as its own process (the ns-3 simulator is a process
+# wide singleton), on a pool of --jobs workers that defaults to the number of
+# cores. Each run writes its CSVs and log into <out>/<point id>/ and the
+# per-run summaries are merged into <out>/summary.csv at the end.
+#
+# The grid is a JSON object mapping program flags to lists of values, e.g.
+#   {"variant": ["cubic", "ecn"], "redMinTh": [20, 40], "RngRun": [1, 2, 3]}
+# "variant" selects a scenario file, scenarios/<variant>.scenario, every other
+# key is passed as --key=value and overrides the scenario.
+# Single axes can also be given on the command line: -p workerRate=600,900
+
+PROGRAM = "DDL-Congestion"
+SCENARIO_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "scenarios")
+VARIANTS = {os.path.splitext(name)[0]: os.path.join(SCENARIO_DIR, name)
+            for name in sorted(os.listdir(SCENARIO_DIR)) if name.endswith(".scenario")}
+
+
+PROFILES = ("optimized", "release", "default", "debug")
+
+
+def find_binary(ns3_dir, program):
+    # ns-3 names scratch binaries ns3.<version>-<program>-<build profile>
+    matches = []
+    for profile in PROFILES:
+        pattern = os.path.join(ns3_dir, "build", "scratch", "ns3*-%s-%s" % (program, profile))
+        matches += [os.path.abspath(m) for m in glob.glob(pattern) if os.access(m, os.X_OK)]
+    if not matches:
+        sys.exit("No built binary for %s under %s, run './ns3 build' first" % (program, ns3_dir))
+    return matches[0]
+
+
+def parse_value(text):
+    for cast in (int, float):
+        try:
+            return cast(text)
+        except ValueError:
+            pass
+    return text
+
+
+def expand_grid(grid):
+    keys = sorted(grid)
+    points = []
+    for values in itertools.product(*(grid[k] for k in keys)):
+        points.append(dict(zip(keys, values)))
+    return points
+
+
+def point_id(index, params):
+    parts = ["%s-%s" % (k, params[k]) for k in sorted(params)]
+    return "%04d_%s" % (index, "_".join(parts))
+
+
+def run_point(ns3_dir, params, out_dir, timeout):
+    variant = params.get("variant", "cubic")
+    binary = find_binary(ns3_dir, PROGRAM)
+    args = [binary, "--scenario=%s" % VARIANTS[variant], "--outDir=%s" % os.path.abspath(out_dir)]
+    args += ["--%s=%s" % (k, v) for k, v in sorted(params.items()) if k != "variant"]
+    os.makedirs(out_dir, exist_ok=True)
+    start = time.time()
+    with open(os.path.join(out_dir, "run.log"), "w") as log:
+        log.write(" ".join(args) + "\n")
+        log.flush()
+        try:
+            proc = subprocess.run(args, cwd=out_dir, stdout=log, stderr=subprocess.STDOUT, timeout=timeout)
+            status = "ok" if proc.returncode == 0 else "exit %d" % proc.returncode
+        except subprocess.TimeoutExpired:
+            status = "timeout"
+    return status, time.time() - start
+
+
+def find_trace(out_dir, prefix):
+    # <prefix><suffix>.csv or .ddlt, whichever trace format the run used
+    for path in sorted(glob.glob(os.path.join(out_dir, prefix + "*"))):
+        if path.endswith((".csv", ".ddlt")):
+            return path
+    return None
+
+
+def queue_stats(path):
+    # Event-driven summaries carry the interval max and time-weighted mean
+    # (columns 2 and 5); plain polled logs only the sampled size.
+    rows = tracereader.read_rows(path)
+    if not rows:
+        return {"mean": 0.0, "max": 0.0}
+    if len(rows[0]) >= 6:
+        return {"mean": sum(float(r[5]) for r in rows) / len(rows), "max": max(float(r[2]) for r in rows)}
+    sizes = [float(row[1]) for row in rows]
+    return {"mean": sum(sizes) / len(sizes), "max": max(sizes)}
+
+
+def load_json(path):
+    with open(path) as f:
+        return json.load(f)
+
+
+def merge_reports(reports):
+    # Distributed runs write run_report.rank<N>.json per rank: events and
+    # memory add up, the run takes as long as the slowest rank
+    if len(reports) == 1:
+        return reports[0]
+    events = sum(r.get("events", 0) for r in reports)
+    wall = max(r.get("run_wall_seconds", 0) for r in reports)
+    sim = max(r.get("sim_seconds", 0) for r in reports)
+    return {
+        "events": events,
+        "events_per_wall_second": events / wall if wall > 0 else 0,
+        "sim_per_wall": sim / wall if wall > 0 else 0,
+        "peak_rss_kb": sum(r.get("peak_rss_kb", 0) for r in reports),
+    }
+
+
+def bucket_quantile(buckets, q, low, high):
+    # Same rule as LogHistogram::Quantile: midpoint of the bucket holding the
+    # q-quantile, clamped to min/max
+    total = sum(count for _, count in buckets)
+    rank = max(1, math.ceil(q * total))
+    seen = 0
+    for value, count in buckets:
+        seen += count
+        if seen >= rank:
+            return min(max(value, low), high)
+    return high
+
+
+def merge_stats(parts):
+    # Distributed runs write stats.rank<N>.json per rank: each queue is on one
+    # rank, the FCT histograms are merged from their buckets
+    if len(parts) == 1:
+        return parts[0]
+    queues = {}
+    for part in parts:
+        queues.update(part.get("queues", {}))
+    fcts = [part["fct_ms"] for part in parts if part.get("fct_ms", {}).get("count")]
+    fct = {"count": 0}
+    if fcts:
+        buckets = {}
+        for part in parts:
+            for value, count in part.get("fct_buckets_ms", []):
+                buckets[value] = buckets.get(value, 0) + count
+        buckets = sorted(buckets.items())
+        count = sum(f["count"] for f in fcts)
+        low = min(f["min"] for f in fcts)
+        high = max(f["max"] for f in fcts)
+        fct = {"count": count, "mean": sum(f["mean"] * f["count"] for f in fcts) / count, "min": low, "max": high}
+        for key, q in (("p50", 0.5), ("p90", 0.9), ("p99", 0.99), ("p999", 0.999)):
+            fct[key] = bucket_quantile(buckets, q, low, high)
+    return {"fct_ms": fct, "queues": queues}
+
+
+def summarize_run(out_dir):
+    summary = {}
+    for name in ("q1", "q2"):
+        path = find_trace(out_dir, "%sSize" % name)
+        if path:
+            stats = queue_stats(path)
+            summary["%s_mean" % name] = stats["mean"]
+            summary["%s_max" % name] = stats["max"]
+        path = find_trace(out_dir, "%sThreshold" % name)
+        if path:
+            # Dynamic ECN marking threshold (--aqm=dynecn)
+            rows = tracereader.read_rows(path)
+            if rows:
+                summary["%s_threshold_mean" % name] = sum(float(row[3]) for row in rows) / len(rows)
+    path = find_trace(out_dir, "throughput")
+    if path:
+        rows = tracereader.read_rows(path)
+        ticks = len({row[0] for row in rows}) or 1
+        summary["total_mbps"] = sum(float(row[5]) for row in rows) / ticks
+    reports = sorted(glob.glob(os.path.join(out_dir, "run_report*.json")))
+    if reports:
+        # Simulator performance from the run report (or its per-rank parts)
+        report = merge_reports([load_json(path) for path in reports])
+        summary["events"] = report.get("events")
+        summary["events_per_s"] = round(report.get("events_per_wall_second", 0))
+        summary["sim_per_wall"] = report.get("sim_per_wall")
+        summary["peak_rss_mb"] = round(report.get("peak_rss_kb", 0) / 1024, 1)
+    stats = sorted(glob.glob(os.path.join(out_dir, "stats*.json")))
+    if stats:
+        # Tail percentiles from the streaming histograms
+        run_stats = merge_stats([load_json(path) for path in stats])
+        fct = run_stats.get("fct_ms", {})
+        if fct.get("count"):
+            summary["fct_p50_ms"] = fct["p50"]
+            summary["fct_p99_ms"] = fct["p99"]
+            summary["fct_p999_ms"] = fct["p999"]
+        for name in ("q1", "q2"):
+            queue = run_stats.get("queues", {}).get(name)
+            if queue:
+                summary["%s_delay_p99_us" % name] = queue["sojourn_us"]["p99"]
+                summary["%s_len_p99" % name] = queue["length_packets"]["p99"]
+    path = find_trace(out_dir, "bursts")
+    if path:
+        # Bytes per on/off worker burst, the offered load (--pcn stretches it)
+        rows = tracereader.read_rows(path)
+        if rows:
+            summary["burst_mb"] = sum(float(row[3]) for row in rows) / len(rows) / 1e6
+    path = find_trace(out_dir, "iteration")
+    if path:
+        # Training runs (--app=ps|ring): iteration time and overlap
+        rows = tracereader.read_rows(path)
+        if rows:
+            summary["iterations"] = len(rows)
+            summary["iteration_ms"] = sum(float(row[5]) for row in rows) / len(rows)
+            summary["exposed_comm_ms"] = sum(float(row[6]) for row in rows) / len(rows)
+            summary["overlap"] = sum(float(row[7]) for row in rows) / len(rows)
+    return summary
+
+
+def flow_throughput(out_dir):
+    # Mean Mbps per data flow ("flow <src>-><dst>:<port>"). Reverse ACK flows
+    # (destination port in the ephemeral range), which the FlowMonitor based
+    # traces in Results/ list, are left out.
+    path = find_trace(out_dir, "throughput")
+    if not path:
+        return {}
+    rows = tracereader.read_rows(path)
+    ticks = len({row[0] for row in rows}) or 1
+    flows = {}
+    for row in rows:
+        if int(row[4]) >= 49152:
+            continue
+        key = "flow %s->%s:%s" % (row[1].strip(), row[3].strip(), row[4].strip())
+        flows[key] = flows.get(key, 0.0) + float(row[5])
+    return {key: total / ticks for key, total in flows.items()}
+
+
+def write_summary(path, records):
+    keys = []
+    for record in records:
+        for key in record:
+            if key not in keys:
+                keys.append(key)
+    with open(path, "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=keys)
+        writer.writeheader()
+        writer.writerows(records)
+
+
+def run_points(ns3_dir, points, out, jobs, timeout):
+    records = []
+    start = time.time()
+    with ThreadPoolExecutor(max_workers=jobs) as pool:
+        futures = {}
+        for index, params in enumerate(points):
+            run_dir = os.path.join(out, point_id(index, params))
+            futures[pool.submit(run_point, ns3_dir, params, run_dir, timeout)] = (index, params, run_dir)
+        for future in as_completed(futures):
+            index, params, run_dir = futures[future]
+            status, wall = future.result()
+            record = {"id": os.path.basename(run_dir), "status": status, "wall_s": round(wall, 2)}
+            record.update(params)
+            if status == "ok":
+                record.update(summarize_run(run_dir))
+            records.append(record)
+            print("[%d/%d] %s %s (%.1f s)" % (len(records), len(points), record["id"], status, wall), flush=True)
+    records.sort(key=lambda r: r["id"])
+    serial = sum(r["wall_s"] for r in records)
+    elapsed = time.time() - start
+    print("%d runs in %.1f s wall, %.1f s serial (%.1fx)" % (len(records), elapsed, serial, serial / max(elapsed, 1e-9)))
+    return records
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Run a parameter grid of DDL-Congestion scenarios in parallel")
+    parser.add_argument("--ns3-dir", required=True, help="ns-3 source tree the programs were built in")
+    parser.add_argument("--grid", help="JSON file mapping flags to lists of values")
+    parser.add_argument("-p", "--param", action="append", default=[], help="flag=v1,v2,... (repeatable)")
+    parser.add_argument("--out", default="sweep_out", help="output directory")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count(), help="parallel runs (default: all cores)")
+    parser.add_argument("--timeout", type=float, default=None, help="per-run timeout in seconds")
+    args = parser.parse_args()
+
+    grid = {}
+    if args.grid:
+        with open(args.grid) as f:
+            grid.update(json.load(f))
+    for param in args.param:
+        key, _, values = param.partition("=")
+        grid[key] = [parse_value(v) for v in values.split(",")]
+    for variant in grid.get("variant", []):
+        if variant not in VARIANTS:
+            sys.exit("Unknown variant %s, expected one of %s" % (variant, ", ".join(VARIANTS)))
+
+    points = expand_grid(grid)
+    os.makedirs(args.out, exist_ok=True)
+    records = run_points(args.ns3_dir, points, args.out, args.jobs, args.timeout)
+    write_summary(os.path.join(args.out, "summary.csv"), records)
+    print("Summary written to %s" % os.path.join(args.out, "summary.csv"))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,91 @@
+import argparse
+import array
+import csv
+import struct
+import sys
+
+# Reader for the traces written by DDL-TraceWriter.h.
+#
+# read_columns(path) returns (names, columns) for either a binary ".ddlt"
+# trace or a CSV file; read_rows(path) returns the data rows. IPv4 columns
+# come back as dotted strings. Run as a script to convert a binary trace to
+# CSV:  python3 tracereader.py throughput.ddlt -o throughput.csv
+
+U32, U64, F64, IPV4 = 0, 1, 2, 3
+TYPECODES = {U32: "I", U64: "Q", F64: "d", IPV4: "I"}
+
+
+def _dotted(value):
+    return "%d.%d.%d.%d" % (value >> 24, (value >> 16) & 0xff, (value >> 8) & 0xff, value & 0xff)
+
+
+def _read_binary(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] != b"DDLT":
+        raise ValueError("%s is not a DDLT trace" % path)
+    version, ncols = struct.unpack_from("<II", data, 4)
+    if version != 1:
+        raise ValueError("Unsupported trace version %d" % version)
+    pos = 12
+    names, types = [], []
+    for _ in range(ncols):
+        ctype, length = struct.unpack_from("<BH", data, pos)
+        pos += 3
+        names.append(data[pos:pos + length].decode())
+        types.append(ctype)
+        pos += length
+    columns = [array.array(TYPECODES[t]) for t in types]
+    while pos < len(data):
+        (rows,) = struct.unpack_from("<I", data, pos)
+        pos += 4
+        for c, ctype in enumerate(types):
+            width = columns[c].itemsize
+            columns[c].frombytes(data[pos:pos + rows * width])
+            pos += rows * width
+    result = []
+    for ctype, column in zip(types, columns):
+        result.append([_dotted(v) for v in column] if ctype == IPV4 else list(column))
+    return names, result
+
+
+def _read_csv(path):
+    with open(path) as f:
+        reader = csv.reader(f)
+        names = next(reader, [])
+        rows = [row for row in reader if row]
+    return names, [list(col) for col in zip(*rows)] if rows else [[] for _ in names]
+
+
+def read_columns(path):
+    if path.endswith(".ddlt"):
+        return _read_binary(path)
+    return _read_csv(path)
+
+
+def read_rows(path):
+    names, columns = read_columns(path)
+    return [list(row) for row in zip(*columns)]
+
+
+def to_csv(path, out):
+    names, columns = read_columns(path)
+    writer = csv.writer(out)
+    writer.writerow(names)
+    writer.writerows(zip(*columns))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert a DDLT binary trace to CSV")
+    parser.add_argument("trace")
+    parser.add_argument("-o", "--output", help="CSV file (default: stdout)")
+    args = parser.parse_args()
+    if args.output:
+        with open(args.output, "w", newline="") as out:
+            to_csv(args.trace, out)
+    else:
+        to_csv(args.trace, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()